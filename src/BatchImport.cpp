@@ -0,0 +1,253 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "BatchImport.h"
+#include "LogSink.h"
+#include "WorkerPool.h"
+#include "datas/master_printer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <ifnpub.h>
+
+void SwapLocale();
+
+static const BatchImporterFactory batchFactories[]{
+    CreateMTFBatchImporter,
+    CreateREBatchImporter,
+};
+
+static std::string ToLower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+bool HandlesExtension(SceneImport &importer, const std::string &fileName) {
+  const std::string lowerName = ToLower(fileName);
+
+  for (int e = 0; e < importer.ExtCount(); e++) {
+    const std::string ext =
+        "." + ToLower(std::to_string(TSTRING(importer.Ext(e))));
+
+    if (lowerName.size() > ext.size() &&
+        !lowerName.compare(lowerName.size() - ext.size(), ext.size(), ext)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static std::unique_ptr<RevilMax> CreateBatchImporter(const std::string &file) {
+  for (auto factory : batchFactories) {
+    if (auto importer = factory(file)) {
+      return importer;
+    }
+  }
+
+  printerror("Unsupported file format: " << file);
+  return {};
+}
+
+// False if import failed, error is reported
+static bool ImportFile(RevilMax &importer, const std::string &fileName) {
+  try {
+    importer.DoImport(fileName, true);
+  } catch (const std::exception &e) {
+    importer.GetCache().Erase(fileName);
+    printerror(fileName << ": " << e.what());
+    return false;
+  } catch (...) {
+    importer.GetCache().Erase(fileName);
+    printerror(fileName << ": Unhandled exception has been thrown!");
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<Interval> BatchImport(const std::vector<std::string> &files,
+                                  const BatchOptions &options) {
+  revilmax::WorkerPool &pool = revilmax::WorkerPool::Get();
+  // Decoded assets of a chunk are held until imported, so cache budget
+  // can't evict them and memory stays bounded
+  const size_t chunkSize = (pool.NumWorkers() + 1) * 2;
+  std::vector<Interval> ranges;
+  TimeValue nextStart = 0;
+  bool sceneReset = false;
+  // Negative index imports all motions at once
+  const std::vector<int32> motions = options.motionIndices.empty()
+                                         ? std::vector<int32>{-1}
+                                         : options.motionIndices;
+
+  SwapLocale();
+
+  for (size_t begin = 0; begin < files.size(); begin += chunkSize) {
+    const size_t count = std::min(chunkSize, files.size() - begin);
+    std::vector<std::unique_ptr<RevilMax>> importers(count);
+    std::vector<std::shared_ptr<void>> assets(count);
+
+    for (size_t i = 0; i < count; i++) {
+      importers[i] = CreateBatchImporter(files[begin + i]);
+    }
+
+    pool.ParallelFor(count, [&](size_t i) {
+      if (!importers[i]) {
+        return;
+      }
+
+      try {
+        assets[i] = importers[i]->FetchAsset(files[begin + i]);
+      } catch (...) {
+        // Reported by import below
+      }
+    });
+
+    for (size_t i = 0; i < count; i++) {
+      if (!importers[i]) {
+        continue;
+      }
+
+      const std::string &fileName = files[begin + i];
+
+      for (size_t m = 0; m < motions.size(); m++) {
+        // DoImport builds up importer state, every motion gets a new one
+        if (m) {
+          importers[i] = CreateBatchImporter(fileName);
+        }
+
+        RevilMax *importer = importers[i].get();
+        importer->ApplyOptions(options, motions[m]);
+        importer->importStart = options.append ? nextStart : 0;
+        importer->keepScene = options.append && sceneReset;
+
+        if (!ImportFile(*importer, fileName)) {
+          break;
+        }
+
+        importer->ReportProfile();
+        const std::vector<Interval> &imported = importer->importedRanges;
+
+        if (!imported.empty()) {
+          ranges.insert(ranges.end(), imported.begin(), imported.end());
+          nextStart = imported.back().End() + GetTicksPerFrame();
+          sceneReset = true;
+        }
+      }
+
+      importers[i].reset();
+      assets[i].reset();
+    }
+  }
+
+  revilmax::LogSink::Get().Flush();
+  SwapLocale();
+
+  if (options.append && ranges.size() > 1) {
+    GetCOREInterface()->SetAnimRange(
+        Interval(ranges.front().Start(), ranges.back().End()));
+  }
+
+  return ranges;
+}
+
+#define REVILMAX_BATCH_INTERFACE Interface_ID(0x5265764d, 0x42746368)
+
+// Scripted import, available as RevilMax interface in MAXScript:
+// RevilMax.importFiles #("a.lmt", "b.lmt") #(0, 2) scale:100 append:true
+// Second argument lists zero based motion indices imported from every file
+// one after another, #() imports all motions.
+// Tolerances apply with reduceKeys, rotationTolerance also to RE imports
+// without it. nativeKeys is Source Keys mode of the dialog. logBones:false
+// stops reporting tracks of bones missing in scene.
+class RevilMaxBatch : public FPStaticInterface {
+public:
+  enum { fnIdImportFiles };
+
+  Tab<Interval> ImportFiles(Tab<const TCHAR *> &files, Tab<int> &motions,
+                            float scale, int frameRate, BOOL resample,
+                            BOOL additive, BOOL disableIK, BOOL logBones,
+                            BOOL reduceKeys, BOOL nativeKeys,
+                            float positionTolerance, float rotationTolerance,
+                            float scaleTolerance, BOOL append, BOOL profile) {
+    std::vector<std::string> fileNames;
+
+    for (int f = 0; f < files.Count(); f++) {
+      fileNames.emplace_back(std::to_string(TSTRING(files[f])));
+    }
+
+    BatchOptions options;
+
+    for (int m = 0; m < motions.Count(); m++) {
+      options.motionIndices.push_back(motions[m]);
+    }
+
+    options.scale = scale;
+    options.frameRate = frameRate;
+    options.resample = resample;
+    options.additive = additive;
+    options.disableIK = disableIK;
+    options.logBones = logBones;
+    options.reduceKeys = reduceKeys;
+    options.nativeKeys = nativeKeys;
+    options.tolerances.position = positionTolerance;
+    options.tolerances.rotation = rotationTolerance;
+    options.tolerances.scale = scaleTolerance;
+    options.append = append;
+    options.profile = profile;
+
+    const std::vector<Interval> ranges = BatchImport(fileNames, options);
+    Tab<Interval> result;
+    result.SetCount(static_cast<int>(ranges.size()));
+    std::copy(ranges.begin(), ranges.end(), result.Addr(0));
+
+    return result;
+  }
+
+  DECLARE_DESCRIPTOR(RevilMaxBatch);
+
+  BEGIN_FUNCTION_MAP
+  FN_15(fnIdImportFiles, TYPE_INTERVAL_TAB_BV, ImportFiles,
+        TYPE_STRING_TAB_BR, TYPE_INT_TAB_BR, TYPE_FLOAT, TYPE_INT, TYPE_BOOL,
+        TYPE_BOOL, TYPE_BOOL, TYPE_BOOL, TYPE_BOOL, TYPE_BOOL, TYPE_FLOAT,
+        TYPE_FLOAT, TYPE_FLOAT, TYPE_BOOL, TYPE_BOOL);
+  END_FUNCTION_MAP
+};
+
+static RevilMaxBatch revilMaxBatch(
+    REVILMAX_BATCH_INTERFACE, _T("RevilMax"), 0, nullptr, FP_CORE,
+    // functions
+    RevilMaxBatch::fnIdImportFiles, _T("importFiles"), 0,
+    TYPE_INTERVAL_TAB_BV, 0, 15,
+    /**/ _T("files"), 0, TYPE_STRING_TAB_BR,
+    /**/ _T("motions"), 0, TYPE_INT_TAB_BR,
+    /**/ _T("scale"), 0, TYPE_FLOAT, f_keyArgDefault, 1.0f,
+    /**/ _T("frameRate"), 0, TYPE_INT, f_keyArgDefault, 60,
+    /**/ _T("resample"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    /**/ _T("additive"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    /**/ _T("disableIK"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    /**/ _T("logBones"), 0, TYPE_BOOL, f_keyArgDefault, TRUE,
+    /**/ _T("reduceKeys"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    /**/ _T("nativeKeys"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    /**/ _T("positionTolerance"), 0, TYPE_FLOAT, f_keyArgDefault, 0.01f,
+    /**/ _T("rotationTolerance"), 0, TYPE_FLOAT, f_keyArgDefault, 0.1f,
+    /**/ _T("scaleTolerance"), 0, TYPE_FLOAT, f_keyArgDefault, 0.001f,
+    /**/ _T("append"), 0, TYPE_BOOL, f_keyArgDefault, TRUE,
+    /**/ _T("profile"), 0, TYPE_BOOL, f_keyArgDefault, FALSE,
+    p_end);
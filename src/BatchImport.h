@@ -0,0 +1,40 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "RevilMax.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Importer for file, nullptr if file extension is not supported
+using BatchImporterFactory =
+    std::unique_ptr<RevilMax> (*)(const std::string &fileName);
+
+std::unique_ptr<RevilMax> CreateMTFBatchImporter(const std::string &fileName);
+std::unique_ptr<RevilMax> CreateREBatchImporter(const std::string &fileName);
+
+// Case insensitive match against importer's extension list
+bool HandlesExtension(SceneImport &importer, const std::string &fileName);
+
+// Decodes files concurrently, then imports them one by one in given order.
+// Returns timeline ranges of all imported motions, failed files are reported
+// and skipped.
+std::vector<Interval> BatchImport(const std::vector<std::string> &files,
+                                  const BatchOptions &options);
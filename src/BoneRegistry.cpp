@@ -0,0 +1,155 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "BoneRegistry.h"
+#include <algorithm>
+#include <max.h>
+
+static std::vector<BoneRegistry *> &Listeners() {
+  static std::vector<BoneRegistry *> listeners;
+  return listeners;
+}
+
+static const int invalidatingCodes[]{
+    NOTIFY_SYSTEM_POST_RESET, NOTIFY_SYSTEM_POST_NEW, NOTIFY_FILE_POST_OPEN,
+    NOTIFY_FILE_POST_MERGE,   NOTIFY_SCENE_UNDO,      NOTIFY_SCENE_REDO,
+};
+
+BoneRegistry::~BoneRegistry() { StopListening(); }
+
+void BoneRegistry::Listen() {
+  if (listening) {
+    return;
+  }
+
+  RegisterNotification(Notify, this, NOTIFY_NODE_CREATED);
+  RegisterNotification(Notify, this, NOTIFY_SCENE_PRE_DELETED_NODE);
+  RegisterNotification(Notify, this, NOTIFY_NODE_RENAMED);
+
+  for (auto c : invalidatingCodes) {
+    RegisterNotification(Notify, this, c);
+  }
+
+  Listeners().push_back(this);
+  listening = true;
+}
+
+void BoneRegistry::StopListening() {
+  if (!listening) {
+    return;
+  }
+
+  UnRegisterNotification(Notify, this, NOTIFY_NODE_CREATED);
+  UnRegisterNotification(Notify, this, NOTIFY_SCENE_PRE_DELETED_NODE);
+  UnRegisterNotification(Notify, this, NOTIFY_NODE_RENAMED);
+
+  for (auto c : invalidatingCodes) {
+    UnRegisterNotification(Notify, this, c);
+  }
+
+  auto &listeners = Listeners();
+  listeners.erase(std::remove(listeners.begin(), listeners.end(), this),
+                  listeners.end());
+  listening = false;
+  valid = false;
+}
+
+void BoneRegistry::Shutdown() {
+  while (!Listeners().empty()) {
+    Listeners().back()->StopListening();
+  }
+}
+
+void BoneRegistry::Notify(void *param, NotifyInfo *info) {
+  BoneRegistry *reg = static_cast<BoneRegistry *>(param);
+
+  switch (info->intcode) {
+  case NOTIFY_NODE_CREATED:
+    // Tags are usually set after creation, check on next query
+    reg->pending.push_back(static_cast<INode *>(info->callParam));
+    break;
+  case NOTIFY_SCENE_PRE_DELETED_NODE:
+    reg->Remove(static_cast<INode *>(info->callParam));
+    break;
+  case NOTIFY_NODE_RENAMED: {
+    // Only names are passed, node is looked up by its new name and its tag
+    // checked again on next query
+    auto change = static_cast<const NameChange *>(info->callParam);
+    INode *node = change && change->newname
+                      ? GetCOREInterface()->GetINodeByName(change->newname)
+                      : nullptr;
+
+    if (node) {
+      reg->pending.push_back(node);
+    }
+    break;
+  }
+  default:
+    reg->Invalidate();
+    break;
+  }
+}
+
+void BoneRegistry::Invalidate() {
+  valid = false;
+  pending.clear();
+}
+
+void BoneRegistry::Remove(INode *node) {
+  nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+  pending.erase(std::remove(pending.begin(), pending.end(), node),
+                pending.end());
+}
+
+void BoneRegistry::Register(INode *node) {
+  if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+    nodes.push_back(node);
+  }
+}
+
+int BoneRegistry::callback(INode *node) {
+  if (node->UserPropExists(tag)) {
+    nodes.push_back(node);
+  }
+
+  return TREE_CONTINUE;
+}
+
+const std::vector<INode *> &BoneRegistry::Nodes() {
+  Listen();
+
+  if (!valid) {
+    nodes.clear();
+    pending.clear();
+    GetCOREInterface7()->GetScene()->EnumTree(this);
+    valid = true;
+  }
+
+  for (auto p : pending) {
+    if (p->UserPropExists(tag)) {
+      Register(p);
+    } else {
+      nodes.erase(std::remove(nodes.begin(), nodes.end(), p), nodes.end());
+    }
+  }
+
+  pending.clear();
+
+  return nodes;
+}
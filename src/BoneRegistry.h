@@ -0,0 +1,55 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "3DSMaxSDKCompat.h"
+#include <inode.h>
+#include <notify.h>
+#include <vector>
+
+// Long lived list of scene nodes with tag user property.
+// Kept up to date from node created/deleted/renamed notifications, whole
+// scene is walked only after reset, file open/merge or undo.
+class BoneRegistry : ITreeEnumProc {
+public:
+  explicit BoneRegistry(const MCHAR *tag_) : tag(tag_) {}
+  ~BoneRegistry();
+
+  const std::vector<INode *> &Nodes();
+  // Node was tagged without a notification
+  void Register(INode *node);
+  // Next Nodes() call will walk the scene
+  void Invalidate();
+
+  // Unregisters notifications of all registries, call before unload
+  static void Shutdown();
+
+private:
+  MSTR tag;
+  std::vector<INode *> nodes;
+  std::vector<INode *> pending;
+  bool valid = false;
+  bool listening = false;
+
+  void Listen();
+  void StopListening();
+  void Remove(INode *node);
+  int callback(INode *node) override;
+  static void Notify(void *param, NotifyInfo *info);
+};
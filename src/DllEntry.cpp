@@ -17,7 +17,10 @@
         Revil Tool uses RevilLib 2017-2019 Lukas Cone
 */
 
+#include "BoneRegistry.h"
+#include "LogSink.h"
 #include "RevilMax.h"
+#include "WorkerPool.h"
 #include "datas/master_printer.hpp"
 #define max(a,b) (((a) > (b)) ? (a) : (b))
 #define min(a,b) (((a) < (b)) ? (a) : (b))
@@ -54,14 +57,17 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, ULONG fdwReason,
   return (TRUE);
 }
 
-static void PrintLog(const char *msg) {
+static void WriteListener(const std::string &text) {
   if (!IsWindowVisible(the_listener_window) || IsIconic(the_listener_window))
     show_listener();
 
-  mprintf(ToTSTRING(msg).c_str());
+  mprintf(ToTSTRING(text).c_str());
   mflush();
 }
 
+// Listener is written in batches, see LogSink
+static void PrintLog(const char *msg) { revilmax::LogSink::Get().Print(msg); }
+
 extern "C" {
 // This function returns a string that describes the DLL and where the user
 // could purchase the DLL if they don't have it.
@@ -96,6 +102,7 @@ __declspec(dllexport) ULONG LibVersion() { return VERSION_3DSMAX; }
 // returns FALSE, the system will NOT load the plugin, it will then call
 // FreeLibrary on your DLL, and send you a message.
 __declspec(dllexport) int LibInitialize(void) {
+  revilmax::LogSink::Get().SetOutput(WriteListener);
   es::print::AddPrinterFunction(PrintLog);
   Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
   return TRUE;
@@ -105,6 +112,9 @@ __declspec(dllexport) int LibInitialize(void) {
 // Perform one-time plugin un-initialization in this method."
 // The system doesn't pay attention to a return value.
 __declspec(dllexport) int LibShutdown(void) {
+  revilmax::LogSink::Get().Flush();
+  BoneRegistry::Shutdown();
+  revilmax::WorkerPool::Release();
   Gdiplus::GdiplusShutdown(gdiplusToken);
   return TRUE;
 }
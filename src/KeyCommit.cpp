@@ -0,0 +1,324 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "KeyCommit.h"
+#include <euler.h>
+#include <vector>
+
+template <class T>
+static void SetValueKeys(Control *cnt, const TimeValue *times, const T *values,
+                         size_t numKeys) {
+  AnimateOn();
+
+  for (size_t k = 0; k < numKeys; k++) {
+    T kVal = values[k];
+    cnt->SetValue(times[k], &kVal);
+  }
+
+  AnimateOff();
+}
+
+static void ClearKeyRange(Control *cnt, const TimeValue *times,
+                          size_t numKeys) {
+  cnt->DeleteTime(Interval(times[0], times[numKeys - 1]),
+                  TIME_INCLEFT | TIME_INCRIGHT | TIME_NOSLIDE);
+}
+
+// Appends whole key table at once, fill sets value of every key
+template <class KeyType, class Fill>
+static void FillKeyTable(Control *cnt, IKeyControl *ikc,
+                         const TimeValue *times, size_t numKeys, Fill &&fill) {
+  ClearKeyRange(cnt, times, numKeys);
+  const int baseKey = ikc->GetNumKeys();
+  ikc->SetNumKeys(baseKey + static_cast<int>(numKeys));
+
+  for (size_t k = 0; k < numKeys; k++) {
+    KeyType key;
+    key.time = times[k];
+    key.flags = 0;
+    fill(key, k);
+    ikc->SetKey(baseKey + static_cast<int>(k), &key);
+  }
+
+  ikc->SortKeys();
+  cnt->NotifyDependents(FOREVER, PART_ALL, REFMSG_CHANGE);
+}
+
+// Linear tangents. Euler rotation axes are interpolated independently, which
+// matches sampled rotation only at keys.
+static void FillFloatKeys(Control *cnt, const TimeValue *times,
+                          const float *values, size_t numKeys) {
+  IKeyControl *ikc = GetKeyControlInterface(cnt);
+
+  if (cnt->ClassID() == Class_ID(LININTERP_FLOAT_CLASS_ID, 0)) {
+    FillKeyTable<ILinFloatKey>(cnt, ikc, times, numKeys,
+                               [&](ILinFloatKey &key, size_t k) {
+                                 key.val = values[k];
+                               });
+  } else {
+    FillKeyTable<IBezFloatKey>(cnt, ikc, times, numKeys,
+                               [&](IBezFloatKey &key, size_t k) {
+                                 key.val = values[k];
+                                 key.intan = 0.f;
+                                 key.outtan = 0.f;
+                                 key.inLength = 1.f / 3.f;
+                                 key.outLength = 1.f / 3.f;
+                                 SetInTanType(key.flags, BEZKEY_LINEAR);
+                                 SetOutTanType(key.flags, BEZKEY_LINEAR);
+                               });
+  }
+}
+
+bool IsSlerpRotation(Control *cnt) {
+  return cnt && cnt->ClassID() == Class_ID(LININTERP_ROTATION_CLASS_ID, 0);
+}
+
+static bool IsFloatKeyable(Control *cnt) {
+  if (!cnt || !GetKeyControlInterface(cnt)) {
+    return false;
+  }
+
+  const Class_ID cID = cnt->ClassID();
+
+  return cID == Class_ID(LININTERP_FLOAT_CLASS_ID, 0) ||
+         cID == Class_ID(HYBRIDINTERP_FLOAT_CLASS_ID, 0);
+}
+
+// How position and scale keys are written into controller
+enum class PointKeys { SetValue, Linear, Bezier, FloatAxes };
+
+static bool HasFloatAxes(Control *cnt) {
+  return IsFloatKeyable(cnt->GetXController()) &&
+         IsFloatKeyable(cnt->GetYController()) &&
+         IsFloatKeyable(cnt->GetZController());
+}
+
+static PointKeys GetPointKeys(Control *cnt, KeyCommitMode mode,
+                              Class_ID linearID, Class_ID bezierID) {
+  if (mode == KeyCommitMode::SetValue) {
+    return PointKeys::SetValue;
+  }
+
+  const Class_ID cID = cnt->ClassID();
+  const bool hasTable = GetKeyControlInterface(cnt) != nullptr;
+
+  if (hasTable && cID == linearID) {
+    return PointKeys::Linear;
+  } else if (hasTable && cID == bezierID) {
+    return PointKeys::Bezier;
+  } else if (HasFloatAxes(cnt)) {
+    return PointKeys::FloatAxes;
+  }
+
+  return PointKeys::SetValue;
+}
+
+static bool HasLinearPointKeys(Control *cnt, KeyCommitMode mode,
+                               Class_ID linearID, Class_ID bezierID) {
+  return cnt && (cnt->ClassID() == linearID ||
+                 GetPointKeys(cnt, mode, linearID, bezierID) !=
+                     PointKeys::SetValue);
+}
+
+// Position XYZ, Scale XYZ
+static void FillAxisKeys(Control *cnt, const TimeValue *times,
+                         const Point3 *values, size_t numKeys) {
+  Control *axes[]{cnt->GetXController(), cnt->GetYController(),
+                  cnt->GetZController()};
+  std::vector<float> axisValues(numKeys);
+
+  for (size_t a = 0; a < 3; a++) {
+    for (size_t k = 0; k < numKeys; k++) {
+      axisValues[k] = values[k][static_cast<int>(a)];
+    }
+
+    FillFloatKeys(axes[a], times, axisValues.data(), numKeys);
+  }
+
+  cnt->NotifyDependents(FOREVER, PART_ALL, REFMSG_CHANGE);
+}
+
+template <class KeyType> static void SetLinearTangents(KeyType &key) {
+  key.intan = Point3(0.f, 0.f, 0.f);
+  key.outtan = Point3(0.f, 0.f, 0.f);
+  key.inLength = Point3(1.f, 1.f, 1.f) / 3.f;
+  key.outLength = Point3(1.f, 1.f, 1.f) / 3.f;
+  SetInTanType(key.flags, BEZKEY_LINEAR);
+  SetOutTanType(key.flags, BEZKEY_LINEAR);
+}
+
+bool HasLinearPositionKeys(Control *cnt, KeyCommitMode mode) {
+  return HasLinearPointKeys(cnt, mode,
+                            Class_ID(LININTERP_POSITION_CLASS_ID, 0),
+                            Class_ID(HYBRIDINTERP_POSITION_CLASS_ID, 0));
+}
+
+bool HasLinearScaleKeys(Control *cnt, KeyCommitMode mode) {
+  return HasLinearPointKeys(cnt, mode, Class_ID(LININTERP_SCALE_CLASS_ID, 0),
+                            Class_ID(HYBRIDINTERP_SCALE_CLASS_ID, 0));
+}
+
+void CommitPositionKeys(Control *cnt, const TimeValue *times,
+                        const Point3 *values, size_t numKeys,
+                        KeyCommitMode mode) {
+  if (!numKeys) {
+    return;
+  }
+
+  IKeyControl *ikc = GetKeyControlInterface(cnt);
+
+  switch (GetPointKeys(cnt, mode, Class_ID(LININTERP_POSITION_CLASS_ID, 0),
+                       Class_ID(HYBRIDINTERP_POSITION_CLASS_ID, 0))) {
+  case PointKeys::Linear:
+    FillKeyTable<ILinPoint3Key>(
+        cnt, ikc, times, numKeys,
+        [&](ILinPoint3Key &key, size_t k) { key.val = values[k]; });
+    break;
+  case PointKeys::Bezier:
+    FillKeyTable<IBezPoint3Key>(cnt, ikc, times, numKeys,
+                                [&](IBezPoint3Key &key, size_t k) {
+                                  key.val = values[k];
+                                  SetLinearTangents(key);
+                                });
+    break;
+  case PointKeys::FloatAxes:
+    FillAxisKeys(cnt, times, values, numKeys);
+    break;
+  case PointKeys::SetValue:
+    SetValueKeys(cnt, times, values, numKeys);
+    break;
+  }
+}
+
+void CommitScaleKeys(Control *cnt, const TimeValue *times,
+                     const Point3 *values, size_t numKeys,
+                     KeyCommitMode mode) {
+  if (!numKeys) {
+    return;
+  }
+
+  IKeyControl *ikc = GetKeyControlInterface(cnt);
+
+  switch (GetPointKeys(cnt, mode, Class_ID(LININTERP_SCALE_CLASS_ID, 0),
+                       Class_ID(HYBRIDINTERP_SCALE_CLASS_ID, 0))) {
+  case PointKeys::Linear:
+    FillKeyTable<ILinScaleKey>(cnt, ikc, times, numKeys,
+                               [&](ILinScaleKey &key, size_t k) {
+                                 key.val = ScaleValue(values[k]);
+                               });
+    break;
+  case PointKeys::Bezier:
+    FillKeyTable<IBezScaleKey>(cnt, ikc, times, numKeys,
+                               [&](IBezScaleKey &key, size_t k) {
+                                 key.val = ScaleValue(values[k]);
+                                 SetLinearTangents(key);
+                               });
+    break;
+  case PointKeys::FloatAxes:
+    FillAxisKeys(cnt, times, values, numKeys);
+    break;
+  case PointKeys::SetValue:
+    SetValueKeys(cnt, times, values, numKeys);
+    break;
+  }
+}
+
+void CommitRotationKeys(Control *cnt, const TimeValue *times,
+                        const Quat *values, size_t numKeys,
+                        KeyCommitMode mode) {
+  if (!numKeys) {
+    return;
+  }
+
+  if (IsSlerpRotation(cnt)) {
+    // Neighbour keys in the same hemisphere, slerp then takes the same path
+    // as reduced keys were fitted to
+    std::vector<Quat> keys(values, values + numKeys);
+
+    for (size_t k = 1; k < numKeys; k++) {
+      const Quat &prev = keys[k - 1];
+      Quat &cur = keys[k];
+
+      if (prev.x * cur.x + prev.y * cur.y + prev.z * cur.z + prev.w * cur.w <
+          0.f) {
+        cur = Quat(-cur.x, -cur.y, -cur.z, -cur.w);
+      }
+    }
+
+    IKeyControl *ikc = GetKeyControlInterface(cnt);
+
+    if (mode == KeyCommitMode::SetValue || !ikc) {
+      SetValueKeys(cnt, times, keys.data(), numKeys);
+      return;
+    }
+
+    FillKeyTable<ILinRotKey>(
+        cnt, ikc, times, numKeys,
+        [&](ILinRotKey &key, size_t k) { key.val = keys[k]; });
+    return;
+  }
+
+  // Euler keys are only written for every frame, see
+  // SceneBackend::HasLinearKeys
+  IEulerControl *eCnt =
+      static_cast<IEulerControl *>(cnt->GetInterface(I_EULERCTRL));
+  Control *axes[]{cnt->GetXController(), cnt->GetYController(),
+                  cnt->GetZController()};
+
+  if (mode == KeyCommitMode::SetValue || !eCnt ||
+      eCnt->GetOrder() != EULERTYPE_XYZ || !IsFloatKeyable(axes[0]) ||
+      !IsFloatKeyable(axes[1]) || !IsFloatKeyable(axes[2])) {
+    SetValueKeys(cnt, times, values, numKeys);
+    return;
+  }
+
+  std::vector<float> angles[3];
+
+  for (auto &a : angles) {
+    a.resize(numKeys);
+  }
+
+  for (size_t k = 0; k < numKeys; k++) {
+    float eAngles[3];
+    QuatToEuler(values[k], eAngles, EULERTYPE_XYZ);
+
+    for (size_t a = 0; a < 3; a++) {
+      // Keep curves continuous across +-PI
+      if (k) {
+        const float prev = angles[a][k - 1];
+
+        while (eAngles[a] - prev > PI) {
+          eAngles[a] -= TWOPI;
+        }
+
+        while (eAngles[a] - prev < -PI) {
+          eAngles[a] += TWOPI;
+        }
+      }
+
+      angles[a][k] = eAngles[a];
+    }
+  }
+
+  for (size_t a = 0; a < 3; a++) {
+    FillFloatKeys(axes[a], times, angles[a].data(), numKeys);
+  }
+
+  cnt->NotifyDependents(FOREVER, PART_ALL, REFMSG_CHANGE);
+}
@@ -0,0 +1,47 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "3DSMaxSDKCompat.h"
+#include <istdplug.h>
+
+enum class KeyCommitMode {
+  // Control::SetValue in animate mode, per key
+  SetValue,
+  // Whole key table through IKeyControl, falls back to SetValue for
+  // unsupported controllers
+  KeyControl,
+};
+
+// Linear rotation controller, keys are interpolated by slerp
+bool IsSlerpRotation(Control *cnt);
+// Keys written by CommitPositionKeys/CommitScaleKeys are interpolated
+// linearly, bezier keys get linear tangents
+bool HasLinearPositionKeys(Control *cnt, KeyCommitMode mode);
+bool HasLinearScaleKeys(Control *cnt, KeyCommitMode mode);
+
+// Keys in range of times are replaced, times must be ascending
+void CommitPositionKeys(Control *cnt, const TimeValue *times,
+                        const Point3 *values, size_t numKeys,
+                        KeyCommitMode mode);
+void CommitRotationKeys(Control *cnt, const TimeValue *times,
+                        const Quat *values, size_t numKeys,
+                        KeyCommitMode mode);
+void CommitScaleKeys(Control *cnt, const TimeValue *times,
+                     const Point3 *values, size_t numKeys, KeyCommitMode mode);
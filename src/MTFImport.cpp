@@ -16,22 +16,32 @@
 
       Revil Tool uses RevilLib 2017-2020 Lukas Cone
 */
+#include "BatchImport.h"
+#include "BoneRegistry.h"
+#include "LogSink.h"
+#include "MappedFile.h"
+#include "MaxScene.h"
+#include "MotionSampler.h"
 #include "RevilMax.h"
+#include "ScenePose.h"
+#include "datas/binreader_stream.hpp"
 #include "datas/except.hpp"
 #include "datas/master_printer.hpp"
 #include "datas/reflector.hpp"
 #include "datas/vectors_simd.hpp"
 #include "revil/lmt.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iiksys.h>
 #include <iksolver.h>
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 #define MTFImport_CLASS_ID Class_ID(0x46f85524, 0xd4337f2)
 static const TCHAR _className[] = _T("MTFImport");
 
-class MTFImport : public SceneImport, RevilMax {
+class MTFImport : public SceneImport, public RevilMax {
 public:
   // Constructor/Destructor
   MTFImport();
@@ -49,9 +59,16 @@ public:
   int DoImport(const TCHAR *name, ImpInterface *i, Interface *gi,
                BOOL suppressPrompts = FALSE) override;
 
-  void DoImport(const std::string &fileName, bool suppressPrompts);
+  void DoImport(const std::string &fileName, bool suppressPrompts) override;
+  std::shared_ptr<void> FetchAsset(const std::string &fileName) override;
 
+  // Places motion on timeline at startTime, nothing is sampled yet
+  MotionBake LayoutMotion(const uni::Motion &mot, TimeValue startTime);
+  // Writes baked samples as keys, returns start of the next motion
+  TimeValue LoadMotion(const MotionBake &bake);
   TimeValue LoadMotion(const uni::Motion &mot, TimeValue startTime = 0);
+  bool PrefetchGrid(const uni::Motion &mot,
+                    revilmax::FrameGrid &grid) override;
 };
 
 class : public ClassDesc2 {
@@ -69,6 +86,16 @@ public:
 
 ClassDesc2 *GetMTFImportDesc() { return &MTFImportDesc; }
 
+std::unique_ptr<RevilMax> CreateMTFBatchImporter(const std::string &fileName) {
+  auto importer = std::make_unique<MTFImport>();
+
+  if (!HandlesExtension(*importer, fileName)) {
+    return {};
+  }
+
+  return importer;
+}
+
 MTFImport::MTFImport() {}
 
 int MTFImport::ExtCount() { return 5; }
@@ -110,6 +137,17 @@ unsigned int MTFImport::Version() { return REVILMAX_VERSIONINT; }
 
 void MTFImport::ShowAbout(HWND hWnd) { ShowAboutDLG(hWnd); }
 
+// Binary copy of LMTNode user properties, stored as node user data
+struct LMTNodeChunk {
+  static constexpr uint32 ID = 0x4c4d544e;
+  static constexpr uint32 VERSION = 1;
+
+  uint32 version;
+  int32 LMTBone;
+  int32 isNub;
+  Vector rest[4];
+};
+
 struct LMTNode {
   union {
     struct {
@@ -118,53 +156,99 @@ struct LMTNode {
     Matrix3 mtx;
   };
   INode *nde;
+  MaxScene::Node node;
   std::unique_ptr<LMTNode> ikTarget;
   int32 LMTBone = -3;
+  bool isNub = false;
+
+  MaxScene::Node GetNode() const { return ikTarget ? ikTarget->node : node; }
+
+  LMTNode(MaxScene &scene, INode *input)
+      : nde(input), node(scene.Wrap(input)) {
+    if (!LoadChunk(scene)) {
+      LoadUserProps(scene);
+      scene.GetUserProp(node, "isnub", isNub);
+      StoreChunk(scene);
+    }
+
+    if (LMTBone > 0 && isNub) {
+      TSTRING bneName = nde->GetName();
+      const size_t bneNameLen = bneName.size();
+
+      if (bneName[bneNameLen - 1] == 'p' && bneName[bneNameLen - 2] == 's' &&
+          bneName[bneNameLen - 3] == '_')
+        bneName.resize(bneNameLen - 3);
+
+      const MaxScene::Node ikNode =
+          scene.FindNode(std::to_string(bneName + _T("_IKTarget")));
+
+      if (ikNode != MaxScene::NO_NODE)
+        ikTarget = std::make_unique<LMTNode>(scene, scene.Get(ikNode));
+    }
+  }
+
+  bool LoadChunk(revilmax::SceneBackend &scene) {
+    std::vector<char> chunk;
+
+    if (!scene.GetUserData(node, LMTNodeChunk::ID, chunk) ||
+        chunk.size() != sizeof(LMTNodeChunk))
+      return false;
+
+    LMTNodeChunk data;
+    memcpy(&data, chunk.data(), sizeof(data));
+
+    if (data.version != LMTNodeChunk::VERSION)
+      return false;
+
+    // Properties are still written by model importer or edited by hand,
+    // chunk is migrated again once they differ
+    int32 propBone;
+    bool propNub = false;
+    scene.GetUserProp(node, "isnub", propNub);
+
+    if (!scene.GetUserProp(node, "LMTBone", propBone) ||
+        propBone != data.LMTBone || propNub != (data.isNub != 0))
+      return false;
 
-  INode *GetNode() { return ikTarget ? ikTarget->nde : nde; }
+    LMTBone = data.LMTBone;
+    isNub = data.isNub != 0;
+    memcpy(&r1, data.rest, sizeof(data.rest));
+    mtx.ValidateFlags();
 
-  LMTNode(INode *input) : nde(input) {
+    return true;
+  }
+
+  void StoreChunk(revilmax::SceneBackend &scene) const {
+    LMTNodeChunk data;
+    data.version = LMTNodeChunk::VERSION;
+    data.LMTBone = LMTBone;
+    data.isNub = isNub;
+    memcpy(data.rest, &r1, sizeof(data.rest));
+
+    scene.SetUserData(node, LMTNodeChunk::ID, &data, sizeof(data));
+  }
+
+  // Legacy storage, migrated into chunk on first scan
+  void LoadUserProps(revilmax::SceneBackend &scene) {
     ReflectorWrap<LMTNode> refl(this);
     const size_t numRefl = refl.GetNumReflectedValues();
     bool corrupted = false;
 
     for (size_t r = 0; r < numRefl; r++) {
       Reflector::KVPair reflPair = refl.GetReflectedPair(r);
-      TSTRING usName = ToTSTRING(reflPair.name);
+      std::string value;
 
-      if (!nde->UserPropExists(usName.c_str())) {
+      if (!scene.GetUserProp(node, std::string(reflPair.name), value)) {
         corrupted = true;
         break;
       }
 
-      MSTR value;
-      nde->GetUserPropString(usName.c_str(), value);
-
-      if (!value.length()) {
+      if (value.empty()) {
         corrupted = true;
         continue;
       }
 
-      refl.SetReflectedValue(reflPair.name, std::to_string(value.data()));
-    }
-
-    if (LMTBone > 0) {
-      BOOL isNub = 0;
-
-      if (nde->GetUserPropBool(_T("isnub"), isNub)) {
-        TSTRING bneName = nde->GetName();
-        const size_t bneNameLen = bneName.size();
-
-        if (bneName[bneNameLen - 1] == 'p' && bneName[bneNameLen - 2] == 's' &&
-            bneName[bneNameLen - 3] == '_')
-          bneName.resize(bneNameLen - 3);
-
-        INode *ikNode = GetCOREInterface()->GetINodeByName(
-            (bneName + _T("_IKTarget")).c_str());
-
-        if (ikNode)
-          ikTarget = std::unique_ptr<LMTNode>(new LMTNode(ikNode));
-      }
+      refl.SetReflectedValue(reflPair.name, value);
     }
 
     if (!corrupted)
@@ -177,10 +261,8 @@ struct LMTNode {
 
     for (int r = 0; r < numRefl; r++) {
       Reflector::KVPair reflPair = refl.GetReflectedPair(r);
-      TSTRING usName = ToTSTRING(reflPair.name);
-      TSTRING usVal = ToTSTRING(reflPair.value);
-
-      nde->SetUserPropString(usName.c_str(), usVal.c_str());
+      scene.SetUserProp(node, std::string(reflPair.name),
+                        std::string(reflPair.value));
     }
   }
 };
@@ -188,84 +270,112 @@ struct LMTNode {
 REFLECT(CLASS(LMTNode), MEMBER(LMTBone), MEMBER(r1), MEMBER(r2), MEMBER(r3),
         MEMBER(r4));
 
-static class : public ITreeEnumProc {
+static class {
 public:
-  const MSTR boneNameHint = _T("LMTBone");
+  const std::string boneNameHint = "LMTBone";
+  BoneRegistry registry{_T("LMTBone")};
 
   std::vector<LMTNode> bones;
+  // LMTBone -> index into bones, -1 if not present
+  std::vector<int32> boneLookup;
+  // First node of -1, -2, -3 LMTBone sentinels
+  int32 sentinelLookup[3];
+  MaxScene scene{MTFImport_CLASS_ID};
+  revilmax::ScenePose pose;
 
   void RescanBones() {
     bones.clear();
-    GetCOREInterface7()->GetScene()->EnumTree(this);
 
-    for (auto &b : bones) {
-      if (b.LMTBone == -1)
-        return;
+    for (auto n : registry.Nodes()) {
+      bones.emplace_back(scene, n);
     }
 
+    bool hasRoot = false;
+
     for (auto &b : bones) {
-      if (b.LMTBone == 255) {
-        b.nde->SetUserPropInt(boneNameHint, -1);
-        b.LMTBone = -1;
+      if (b.LMTBone == -1) {
+        hasRoot = true;
+        break;
+      }
+    }
+
+    if (!hasRoot) {
+      for (auto &b : bones) {
+        if (b.LMTBone == 255) {
+          scene.SetUserProp(b.node, boneNameHint, "-1");
+          b.LMTBone = -1;
+          b.StoreChunk(scene);
+        }
       }
     }
-  }
 
-  void RestoreBasePose(TimeValue atTime) {
-    AnimateOn();
+    BuildLookup();
 
-    for (auto &n : bones) {
-      SetXFormPacket packet(n.mtx);
-      n.nde->GetTMController()->SetValue(atTime, &packet);
+    std::vector<MaxScene::Node> nodes;
+    std::vector<revilmax::BoneTransform> restPose;
+
+    for (auto &b : bones) {
+      nodes.push_back(b.node);
+      restPose.push_back(ToBoneTransform(b.mtx));
     }
 
-    AnimateOff();
+    pose.Build(scene, nodes, restPose);
   }
 
-  void LockPose(TimeValue atTime) {
-    for (auto &b : bones) {
-      Matrix3 pMat = b.nde->GetParentTM(atTime);
-      pMat.Invert();
-      Matrix3 mtx = b.nde->GetNodeTM(atTime) * pMat;
-      SetXFormPacket packet(mtx);
-      AnimateOn();
-      b.nde->GetTMController()->SetValue(atTime, &packet);
-      AnimateOff();
+  void BuildLookup() {
+    boneLookup.clear();
+    std::fill(std::begin(sentinelLookup), std::end(sentinelLookup), -1);
+
+    for (int32 i = 0; i < static_cast<int32>(bones.size()); i++) {
+      const int32 ID = bones[i].LMTBone;
+
+      if (ID < 0) {
+        const int32 sentinel = -ID - 1;
+
+        if (sentinel < 3 && sentinelLookup[sentinel] < 0)
+          sentinelLookup[sentinel] = i;
+
+        continue;
+      }
+
+      if (ID >= static_cast<int32>(boneLookup.size()))
+        boneLookup.resize(ID + 1, -1);
+
+      if (boneLookup[ID] < 0)
+        boneLookup[ID] = i;
     }
   }
 
+  // Rest pose was read from bone chunks by RescanBones
+  void RestoreBasePose(TimeValue atTime) { pose.KeyRestPose(atTime); }
+
+  // Keys last committed pose, so next motion doesn't blend into this one
+  void LockPose(TimeValue atTime) { pose.KeyEndPose(atTime); }
+
   void ResetScene() {
     SuspendAnimate();
 
     for (auto &n : bones) {
-      Control *cnt = n.nde->GetTMController();
-      cnt->GetScaleController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
-      cnt->GetRotationController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
-      cnt->GetPositionController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
+      scene.DeleteKeys(n.node);
     }
   }
 
   void SetIKState(bool enabled) {
     for (auto &n : bones) {
-      if (n.LMTBone != -3)
-        continue;
-
-      Control *ikCnt = n.nde->GetTMController();
-
-      if (ikCnt->ClassID() == IKCHAINCONTROL_CLASS_ID) {
-        IParamBlock2 *bck = ikCnt->GetParamBlock(IIKChainControl::kParamBlock);
-        bck->SetValue(IIKChainControl::kAutoSnap, 0, 0);
-        Control *enableCnt =
-            (Control *)ikCnt->GetReference(IIKChainControl::kEnableRef);
-
-        BOOL iEnabled = enabled;
-
-        enableCnt->SetValue(0, &iEnabled);
-      }
+      if (n.LMTBone == -3)
+        scene.SetIKEnabled(n.node, enabled);
     }
   }
 
+  // Chains ending in split bones are moved onto their _sp nodes.
+  // Stays on 3ds Max, MemoryScene doesn't solve IK.
   void RestoreIKChains() {
+    auto isScaleNode = [&](INode *joint) {
+      int32 LMTID;
+      return scene.GetUserProp(scene.Wrap(joint), boneNameHint, LMTID) &&
+             LMTID == -2;
+    };
+
     for (auto &n : bones) {
       if (n.LMTBone != -3)
         continue;
@@ -276,27 +386,18 @@ public:
         IParamBlock2 *bck = ikCnt->GetParamBlock(IIKChainControl::kParamBlock);
         INode *startJoint = bck->GetINode(IIKChainControl::kStartJoint);
         INode *endJoint = bck->GetINode(IIKChainControl::kEndJoint);
-        int LMTID;
         bool updateIKSolver = false;
 
-        if (startJoint->UserPropExists(boneNameHint)) {
-          startJoint->GetUserPropInt(boneNameHint, LMTID);
-
-          if (LMTID == -2) {
-            ikCnt->ReplaceReference(IIKChainControl::kStartJointRef,
-                                    startJoint->GetParentNode(), 0);
-            updateIKSolver = true;
-          }
+        if (isScaleNode(startJoint)) {
+          ikCnt->ReplaceReference(IIKChainControl::kStartJointRef,
+                                  startJoint->GetParentNode(), 0);
+          updateIKSolver = true;
         }
 
-        if (endJoint->UserPropExists(boneNameHint)) {
-          endJoint->GetUserPropInt(boneNameHint, LMTID);
-
-          if (LMTID == -2) {
-            ikCnt->ReplaceReference(IIKChainControl::kEndJointRef,
-                                    endJoint->GetParentNode(), 0);
-            updateIKSolver = true;
-          }
+        if (isScaleNode(endJoint)) {
+          ikCnt->ReplaceReference(IIKChainControl::kEndJointRef,
+                                  endJoint->GetParentNode(), 0);
+          updateIKSolver = true;
         }
 
         if (updateIKSolver) {
@@ -308,342 +409,420 @@ public:
   }
 
   LMTNode *LookupNode(int ID) {
-    for (auto &b : bones) {
-      if (b.LMTBone == ID)
-        return &b;
-    }
+    int32 index = -1;
 
-    return nullptr;
-  }
+    if (ID < 0) {
+      const int32 sentinel = -ID - 1;
 
-  int callback(INode *node) {
-    if (node->UserPropExists(boneNameHint)) {
-      bones.push_back(node);
+      if (sentinel < 3)
+        index = sentinelLookup[sentinel];
+    } else if (ID < static_cast<int32>(boneLookup.size())) {
+      index = boneLookup[ID];
     }
 
-    return TREE_CONTINUE;
+    return index < 0 ? nullptr : &bones[index];
   }
 } iBoneScanner;
 
-struct MTFTrackPair {
-  INode *nde;
-  const uni::MotionTrack *track;
-  INode *scaleNode;
-  MTFTrackPair *parent;
-  std::vector<Vector4A16> frames;
-  std::vector<MTFTrackPair *> children;
-
-  MTFTrackPair(INode *inde, const uni::MotionTrack *tck,
-               MTFTrackPair *prent = nullptr)
-      : nde(inde), track(tck), scaleNode(nullptr), parent(prent) {}
-};
-
-typedef std::vector<MTFTrackPair> MTFTrackPairCnt;
 typedef std::vector<TimeValue> Times;
-typedef std::vector<float> Secs;
 
-static bool IsRoot(MTFTrackPairCnt &collection, INode *item) {
-  if (item->IsRootNode())
-    return true;
+// Scale animated bones and everything below them, parents always precede
+// their children. Every bone is split into _sp node, which keeps bone's
+// children, and a leaf scale node, so scale is not inherited.
+struct ScaleHierarchy {
+  using Node = MaxScene::Node;
+
+  struct Item {
+    Node node;
+    Node scaleNode;
+    const revilmax::TrackSamples *track;
+    int32 parent;
+  };
 
-  auto fnd = std::find_if(collection.begin(), collection.end(),
-                          [item](const MTFTrackPair &i0) {
-                            return i0.nde == item->GetParentNode();
-                          });
+  struct LocalTranslation {
+    const revilmax::TrackSamples *track;
+    Vector4A16 offset;
+  };
 
-  if (fnd != collection.end())
-    return false;
+  std::vector<Item> items;
+  // Committed position tracks of non root bones, keyed by bone node
+  std::unordered_map<Node, LocalTranslation> translations;
+  // Cumulative scale, numFrames values per item
+  std::vector<Vector4A16> frames;
+  size_t numFrames = 0;
 
-  return IsRoot(collection, item->GetParentNode());
-}
+  const Vector4A16 *Frames(size_t item) const {
+    return frames.data() + item * numFrames;
+  }
 
-static INode *BuildScaleHandles(MTFTrackPairCnt &pairs, MTFTrackPair &item,
-                                const Times &times) {
-  INode *fNode = item.nde;
-  int numChildren = fNode->NumberOfChildren();
+  Vector4A16 *Frames(size_t item) { return frames.data() + item * numFrames; }
 
-  for (int c = 0; c < numChildren; c++) {
-    int LMTIndex;
-    INode *childNode = fNode->GetChildNode(c);
+  static Node FindScaleNode(revilmax::SceneBackend &scene, Node node) {
+    for (Node child : scene.Children(node)) {
+      int32 LMTIndex;
 
-    if (childNode->GetUserPropInt(iBoneScanner.boneNameHint, LMTIndex) &&
-        LMTIndex == -2) {
-      item.scaleNode = childNode;
-      break;
+      if (scene.GetUserProp(child, iBoneScanner.boneNameHint, LMTIndex) &&
+          LMTIndex == -2) {
+        return child;
+      }
     }
-  }
 
-  if (!item.scaleNode) {
-    INodeTab baseBone;
-    INodeTab clonedBone;
-    Point3 dummy;
-    baseBone.AppendNode(fNode);
+    return MaxScene::NO_NODE;
+  }
 
-    GetCOREInterface()->CloneNodes(baseBone, dummy, false, NODE_COPY, nullptr,
-                                   &clonedBone);
-    item.scaleNode = fNode;
-    item.nde = clonedBone[0];
+  void Build(const revilmax::MotionSamples &samples, size_t numFrames_) {
+    revilmax::SceneBackend &scene = iBoneScanner.scene;
+    numFrames = numFrames_;
+    std::vector<Node> tracked;
+    std::unordered_map<Node, const revilmax::TrackSamples *> tracks;
 
-    TSTRING bName = fNode->GetName();
-    bName.append(_T("_sp"));
+    for (auto &t : samples) {
+      if (t.trackType != uni::MotionTrack::TrackType_e::Scale)
+        continue;
 
-    item.nde->SetName(ToBoneName(bName));
-    fNode->SetUserPropInt(iBoneScanner.boneNameHint, -2);
-    fNode->GetParentNode()->AttachChild(item.nde);
+      LMTNode *lNode = iBoneScanner.LookupNode(t.boneIndex);
 
-    for (int c = 0; c < numChildren; c++)
-      item.nde->AttachChild(fNode->GetChildNode(0));
+      if (lNode && tracks.emplace(lNode->node, &t).second)
+        tracked.push_back(lNode->node);
+    }
 
-    item.nde->AttachChild(fNode);
-    fNode->SetUserPropString(_T("r1"), _T(""));
-    fNode->SetUserPropString(_T("r2"), _T(""));
-    fNode->SetUserPropString(_T("r3"), _T(""));
-    fNode->SetUserPropString(_T("r4"), _T(""));
-  }
+    auto hasTrackedParent = [&](Node node) {
+      for (Node p = scene.Parent(node); p != MaxScene::NO_NODE;
+           p = scene.Parent(p)) {
+        if (tracks.count(p))
+          return true;
+      }
 
-  item.frames.resize(times.size(), Vector4A16(1.f));
+      return false;
+    };
 
-  fNode = item.nde;
-  numChildren = fNode->NumberOfChildren();
+    for (auto node : tracked) {
+      if (!hasTrackedParent(node))
+        items.push_back({node, MaxScene::NO_NODE, tracks[node], -1});
+    }
 
-  std::vector<INode *> childNodes;
+    // Breadth first, items grow while being walked
+    for (size_t i = 0; i < items.size(); i++) {
+      const Node node = items[i].node;
+      const Node scaleNode = FindScaleNode(scene, node);
+      items[i].scaleNode = scaleNode;
+
+      for (Node child : scene.Children(node)) {
+        if (child == scaleNode)
+          continue;
+
+        auto found = tracks.find(child);
+        const revilmax::TrackSamples *track =
+            found == tracks.end() ? nullptr : found->second;
+        items.push_back(
+            {child, MaxScene::NO_NODE, track, static_cast<int32>(i)});
+      }
+    }
+  }
 
-  for (int c = 0; c < numChildren; c++) {
-    INode *childNode = fNode->GetChildNode(c);
+  // Clones all unsplit bones at once, then rewires them parents first
+  void SplitNodes() {
+    MaxScene &scene = iBoneScanner.scene;
+    std::vector<Node> baseBones;
 
-    if (childNode == item.scaleNode)
-      continue;
+    for (auto &item : items) {
+      if (item.scaleNode == MaxScene::NO_NODE)
+        baseBones.push_back(item.node);
+    }
 
-    childNodes.push_back(childNode);
-  }
+    if (baseBones.empty())
+      return;
 
-  for (auto c : childNodes) {
-    const uni::MotionTrack *foundTrack = nullptr;
+    std::vector<Node> clones(baseBones.size());
+    scene.CloneNodes(baseBones.data(), baseBones.size(), "_sp",
+                     clones.data());
+    size_t curClone = 0;
 
-    for (auto &t : pairs)
-      if (t.nde == c || t.scaleNode == c) {
-        foundTrack = t.track;
-        break;
-      }
+    for (auto &item : items) {
+      if (item.scaleNode != MaxScene::NO_NODE)
+        continue;
 
-    MTFTrackPair *nChild = new MTFTrackPair(c, foundTrack, &item);
-    item.children.push_back(nChild);
-    BuildScaleHandles(pairs, **std::prev(item.children.end()), times);
-  }
+      const Node node = item.node;
+      const Node clone = clones[curClone++];
 
-  return fNode;
-}
+      iBoneScanner.registry.Register(scene.Get(clone));
+      scene.SetUserProp(node, iBoneScanner.boneNameHint, "-2");
 
-static void PopulateScaleData(MTFTrackPair &item, const Times &times,
-                              const Secs &secs) {
-  if (!item.scaleNode)
-    return;
+      for (Node child : scene.Children(node))
+        scene.SetParent(child, clone);
 
-  const size_t numKeys = times.size();
-  Control *cnt = item.scaleNode->GetTMController();
+      scene.SetParent(node, clone);
+      scene.SetUserProp(node, "r1", "");
+      scene.SetUserProp(node, "r2", "");
+      scene.SetUserProp(node, "r3", "");
+      scene.SetUserProp(node, "r4", "");
+      scene.ClearUserData(node, LMTNodeChunk::ID);
 
-  AnimateOn();
+      item.scaleNode = node;
+      item.node = clone;
+    }
+  }
 
-  if (item.track) {
-    for (int t = 0; t < numKeys; t++) {
-      Vector4A16 cVal;
-      item.track->GetValue(cVal, secs[t]);
-      item.frames[t] *= cVal;
+  void ComputeScales() {
+    frames.assign(items.size() * numFrames, Vector4A16(1.f));
 
-      if (item.parent)
-        item.frames[t] *= item.parent->frames[t];
+    for (size_t i = 0; i < items.size(); i++) {
+      const Item &item = items[i];
 
-      Matrix3 cMat(1);
-      cMat.SetScale(
-          Point3(item.frames[t].X, item.frames[t].Y, item.frames[t].Z));
+      if (!item.track)
+        continue;
 
-      SetXFormPacket packet(cMat);
+      Vector4A16 *iFrames = Frames(i);
+      std::copy_n(item.track->values.data(), numFrames, iFrames);
 
-      cnt->SetValue(times[t], &packet);
+      if (item.parent >= 0)
+        revilmax::MultiplySamples(iFrames, Frames(item.parent), numFrames);
     }
   }
 
-  AnimateOff();
+  // Scales are reduced only on scale handles with linear keys.
+  // Returns number of written keys.
+  size_t CommitScales(const Times &times,
+                      const revilmax::ReduceTolerances *tolerances) const {
+    revilmax::SceneBackend &scene = iBoneScanner.scene;
+    std::vector<uint32> keyFrames;
+    Times keyTimes;
+    std::vector<Vector4A16> keyValues;
+    size_t numKeys = 0;
 
-  for (auto &c : item.children)
-    PopulateScaleData(*c, times, secs);
-}
+    for (size_t i = 0; i < items.size(); i++) {
+      const Item &item = items[i];
 
-static void
-FixupHierarchialTranslations(INode *nde, const Times &times,
-                             const std::vector<Vector4A16> &scaleValues,
-                             const std::vector<Matrix3> *parentTransforms) {
-  const size_t numKeys = times.size();
-  const int numChildren = nde->NumberOfChildren();
-  std::vector<Point3> values;
-  values.resize(numKeys);
-
-  for (int c = 0; c < numChildren; c++) {
-    INode *childNode = nde->GetChildNode(c);
-    int LMTIndex;
-
-    if (childNode->GetUserPropInt(iBoneScanner.boneNameHint, LMTIndex) &&
-        LMTIndex == -2)
-      continue;
+      if (!item.track || !numFrames)
+        continue;
 
-    for (int t = 0; t < numKeys; t++) {
-      Matrix3 rVal = childNode->GetNodeTM(times[t]);
-      Matrix3 pVal = nde->GetNodeTM(times[t]);
-      pVal.Invert();
-      rVal *= pVal;
-      values[t] = rVal.GetTrans() *
-                  Point3(scaleValues[t].X, scaleValues[t].Y, scaleValues[t].Z);
-    }
+      const Vector4A16 *iFrames = Frames(i);
 
-    Control *cnt = childNode->GetTMController()->GetPositionController();
+      if (tolerances &&
+          scene.HasLinearKeys(item.scaleNode, uni::MotionTrack::Scale)) {
+        keyFrames = revilmax::ReduceKeys(
+            iFrames, numFrames, uni::MotionTrack::Scale, tolerances->scale);
+      } else {
+        keyFrames.resize(numFrames);
 
-    AnimateOn();
+        for (uint32 t = 0; t < numFrames; t++)
+          keyFrames[t] = t;
+      }
 
-    for (int t = 0; t < numKeys; t++) {
-      cnt->SetValue(times[t], &values[t]);
+      keyTimes.resize(keyFrames.size());
+      keyValues.resize(keyFrames.size());
+
+      for (size_t k = 0; k < keyFrames.size(); k++) {
+        keyTimes[k] = times[keyFrames[k]];
+        keyValues[k] = iFrames[keyFrames[k]];
+      }
+
+      scene.CommitKeys(item.scaleNode, uni::MotionTrack::Scale,
+                       keyTimes.data(), keyValues.data(), keyValues.size());
+      iBoneScanner.pose.SetEndScale(item.scaleNode, keyValues.back());
+      numKeys += keyFrames.size();
     }
 
-    AnimateOff();
+    return numKeys;
   }
-}
 
-static void ScaleTranslations(MTFTrackPair &item, const Times &times) {
-  if (!item.scaleNode)
-    return;
+  // Scales local translations of children by cumulative scale of their
+  // parent. Translations come from sampled position tracks or rest pose, so
+  // the scene is not evaluated. Returns number of written keys.
+  size_t ScaleTranslations(const Times &times) const;
+};
 
-  std::vector<Matrix3> absValues;
-  absValues.reserve(times.size());
+size_t ScaleHierarchy::ScaleTranslations(const Times &times) const {
+  if (!numFrames)
+    return 0;
 
-  for (auto t : times)
-    absValues.push_back(item.nde->GetNodeTM(t));
+  revilmax::SceneBackend &scene = iBoneScanner.scene;
+  const revilmax::ScenePose &pose = iBoneScanner.pose;
+  std::vector<Vector4A16> values(numFrames);
+  size_t numKeys = 0;
 
-  FixupHierarchialTranslations(item.nde, times, item.frames, &absValues);
+  for (size_t i = 0; i < items.size(); i++) {
+    const Item &item = items[i];
+    const Vector4A16 *scales = Frames(i);
 
-  for (auto &c : item.children) {
-    ScaleTranslations(*c, times);
-  }
-}
+    for (Node child : scene.Children(item.node)) {
+      if (child == item.scaleNode)
+        continue;
 
-TimeValue MTFImport::LoadMotion(const uni::Motion &mot, TimeValue startTime) {
-  const float aDuration = mot.Duration();
+      auto found = translations.find(child);
 
-  TimeValue numTicks = SecToTicks(aDuration);
-  const TimeValue ticksPerFrame = GetTicksPerFrame();
-  TimeValue overlappingTicks = numTicks % ticksPerFrame;
+      if (found != translations.end()) {
+        const Vector4A16 *positions = found->second.track->values.data();
+        const Vector4A16 offset = found->second.offset;
 
-  if (overlappingTicks > (ticksPerFrame / 2))
-    numTicks += ticksPerFrame - overlappingTicks;
-  else
-    numTicks -= overlappingTicks;
+        for (size_t t = 0; t < numFrames; t++)
+          values[t] = (positions[t] + offset) * scales[t];
+      } else {
+        // No position track, bone stays at its rest pose.
+        // Only nodes outside of LMT skeleton are evaluated.
+        const int32 bone = pose.FindBone(child);
+        const Vector4A16 basePos =
+            bone < 0 ? scene.LocalTransform(child, times.front()).translation
+                     : pose.Rest(bone).translation;
 
-  Interval aniRange(startTime, startTime + numTicks - ticksPerFrame);
-  std::vector<float> frameTimes;
-  Times frameTimesTicks;
+        for (size_t t = 0; t < numFrames; t++)
+          values[t] = basePos * scales[t];
+      }
 
-  for (TimeValue v = aniRange.Start(); v <= aniRange.End();
-       v += ticksPerFrame) {
-    frameTimes.push_back(TicksToSec(v - startTime));
-    frameTimesTicks.push_back(v);
+      scene.CommitKeys(child, uni::MotionTrack::Position, times.data(),
+                       values.data(), numFrames);
+      iBoneScanner.pose.SetEndTranslation(child, values.back());
+      numKeys += numFrames;
+    }
   }
 
-  const size_t numFrames = frameTimes.size();
-  std::vector<MTFTrackPair> scaleTracks;
+  return numKeys;
+}
 
-  for (auto &t : mot) {
-    const size_t boneID = t->BoneIndex();
-    LMTNode *lNode = iBoneScanner.LookupNode(boneID);
+MotionBake MTFImport::LayoutMotion(const uni::Motion &mot,
+                                   TimeValue startTime) {
+  MotionBake bake;
+  bake.motion = &mot;
+  bake.sceneGrid = revilmax::BuildFrameGrid(mot.Duration(), GetTicksPerFrame(),
+                                            startTime, false);
+  bake.grid = revilmax::BuildFrameGrid(
+      mot.Duration(), SampleTicksPerFrame(mot), startTime, false);
 
-    if (!lNode)
-      continue;
+  return bake;
+}
 
-    if (t->TrackType() == uni::MotionTrack::TrackType_e::Scale)
-      scaleTracks.emplace_back(lNode->nde, t.get());
+TimeValue MTFImport::LoadMotion(const uni::Motion &mot, TimeValue startTime) {
+  MotionBake bake = LayoutMotion(mot, startTime);
+  BakeMotion(bake);
 
-    /*if (t.BoneType())
-      printline("Bone: " << es::ToUTF8(lNode->nde->GetName())
-                          << ", RuleID: " << tck->BoneType());*/
-  }
+  return LoadMotion(bake);
+}
 
-  std::vector<MTFTrackPair *> rootsOnly;
+TimeValue MTFImport::LoadMotion(const MotionBake &bake) {
+  const revilmax::MotionSamples &samples = bake.samples;
+  const revilmax::FrameGrid &grid = bake.grid;
+  const TimeValue startTime = bake.sceneGrid.start;
+  const Times &frameTimesTicks = grid.ticks;
+  ScaleHierarchy scaleHierarchy;
+
+  {
+    revilmax::ScopedPhase phase(profile, "scale handles");
+    scaleHierarchy.Build(samples, grid.NumFrames());
+    scaleHierarchy.SplitNodes();
+  }
 
-  for (auto &s : scaleTracks)
-    if (IsRoot(scaleTracks, s.nde))
-      rootsOnly.push_back(&s);
+  {
+    revilmax::ScopedPhase phase(profile, "scene scan");
+    iBoneScanner.RescanBones();
+  }
 
-  for (auto &s : rootsOnly)
-    BuildScaleHandles(scaleTracks, *s, frameTimesTicks);
+  {
+    revilmax::ScopedPhase phase(profile, "pose lock/restore");
+    iBoneScanner.RestoreBasePose(startTime);
+  }
 
-  iBoneScanner.RescanBones();
-  iBoneScanner.RestoreBasePose(startTime);
+  revilmax::ScopedPhase commitPhase(profile, "key commit");
+  MaxScene &scene = iBoneScanner.scene;
+  revilmax::ScenePose &pose = iBoneScanner.pose;
   const bool additive = checked[Checked::CH_ADDITIVE];
+  Times times;
+  std::vector<Vector4A16> values;
+  size_t numKeysWritten = 0;
+  scene.keyCommitMode = keyCommitMode;
 
-  for (auto &t : mot) {
-    const int32 boneID = t->BoneIndex();
+  for (auto &t : samples) {
+    const int32 boneID = t.boneIndex;
     LMTNode *lNode = iBoneScanner.LookupNode(boneID);
 
     if (!lNode) {
       if (!checked[Checked::CH_NOLOGBONES]) {
         printwarning("[MTF] Couldn't find LMTBone: " << boneID);
       }
+
+      profile.Count("tracks skipped");
       continue;
     }
 
-    INode *fNode =
-        !checked[Checked::CH_DISABLEIK] ? lNode->GetNode() : lNode->nde;
-    Control *cnt = fNode->GetTMController();
+    // Committed to scale handles by scaleHierarchy
+    if (t.trackType == uni::MotionTrack::TrackType_e::Scale)
+      continue;
+
+    const MaxScene::Node node =
+        !checked[Checked::CH_DISABLEIK] ? lNode->GetNode() : lNode->node;
+    const bool isRoot = scene.Parent(node) == MaxScene::NO_NODE;
+    // Controllers of user rigs are never replaced, euler rotations and other
+    // non linear controllers are keyed at every frame
+    const bool everyFrame =
+        !t.keyFrames.empty() && !scene.HasLinearKeys(node, t.trackType);
+    const size_t numKeys = everyFrame ? t.values.size() : t.NumKeys();
+    times.resize(numKeys);
+    values.resize(numKeys);
+
+    if (everyFrame)
+      profile.Count("tracks unreduced");
+
+    for (size_t k = 0; k < numKeys; k++) {
+      const size_t frame = everyFrame ? k : t.KeyFrame(k);
+      times[k] = frameTimesTicks[frame];
+      values[k] = t.values[frame];
+    }
 
-    switch (t->TrackType()) {
+    switch (t.trackType) {
     case uni::MotionTrack::TrackType_e::Position: {
-      Control *posCnt = cnt->GetPositionController();
-      Point3 additivum;
+      Vector4A16 additivum;
 
       if (additive) {
-        posCnt->GetValue(-1, &additivum, FOREVER);
+        const int32 bone = pose.FindBone(node);
+        additivum = bone < 0 ? scene.LocalTransform(node, -1).translation
+                             : pose.Rest(bone).translation;
       }
 
-      AnimateOn();
+      if (isRoot && !additive)
+        revilmax::CorrectRootPositions(values.data(), numKeys);
 
-      for (int i = 0; i < numFrames; i++) {
-        Vector4A16 cVal;
-        t->GetValue(cVal, frameTimes[i]);
-        cVal *= objectScale;
-        Point3 kVal = reinterpret_cast<Point3 &>(cVal);
+      for (auto &k : values)
+        k += additivum;
 
-        if (fNode->GetParentNode()->IsRootNode() && !additive)
-          kVal = corMat.PointTransform(kVal);
+      scene.CommitKeys(node, t.trackType, times.data(), values.data(),
+                       numKeys);
+      numKeysWritten += numKeys;
 
-        kVal += additivum;
-        posCnt->SetValue(frameTimesTicks[i], &kVal);
-      }
+      if (numKeys)
+        pose.SetEndTranslation(node, values.back());
 
-      AnimateOff();
+      // Scale hierarchy is walked by bone nodes, not by their IK targets
+      if (scene.Parent(lNode->node) != MaxScene::NO_NODE)
+        scaleHierarchy.translations[lNode->node] = {&t, additivum};
       break;
     }
     case uni::MotionTrack::TrackType_e::Rotation: {
-      Control *rotCnt = cnt->GetRotationController();
       Quat additivum;
 
       if (additive) {
-        rotCnt->GetValue(-1, &additivum, FOREVER);
+        const int32 bone = pose.FindBone(node);
+        const Vector4A16 rest = bone < 0
+                                    ? scene.LocalTransform(node, -1).rotation
+                                    : pose.Rest(bone).rotation;
+        additivum = Quat(rest.X, rest.Y, rest.Z, rest.W);
       }
-      AnimateOn();
 
-      for (int i = 0; i < numFrames; i++) {
-        Vector4A16 cVal;
-        t->GetValue(cVal, frameTimes[i]);
-        Quat kVal = reinterpret_cast<Quat &>(cVal).Conjugate();
+      if (isRoot && !additive)
+        revilmax::CorrectRootRotations(values.data(), numKeys);
 
-        if (fNode->GetParentNode()->IsRootNode() && !additive) {
-          Matrix3 cMat;
-          cMat.SetRotate(kVal);
-          kVal = cMat * corMat;
+      if (additive) {
+        for (auto &k : values) {
+          Quat kVal(k.X, k.Y, k.Z, k.W);
+          kVal += additivum;
+          k = Vector4A16(kVal.x, kVal.y, kVal.z, kVal.w);
         }
-
-        kVal += additivum;
-        rotCnt->SetValue(frameTimesTicks[i], &kVal);
       }
 
-      AnimateOff();
+      scene.CommitKeys(node, t.trackType, times.data(), values.data(),
+                       numKeys);
+      numKeysWritten += numKeys;
+
+      if (numKeys)
+        pose.SetEndRotation(node, values.back());
       break;
     }
     default:
@@ -651,35 +830,74 @@ TimeValue MTFImport::LoadMotion(const uni::Motion &mot, TimeValue startTime) {
     }
   }
 
-  for (auto &s : rootsOnly)
-    PopulateScaleData(*s, frameTimesTicks, frameTimes);
-
-  for (auto &s : rootsOnly)
-    ScaleTranslations(*s, frameTimesTicks);
+  const revilmax::ReduceTolerances tolerances = GetTolerances();
+  const revilmax::ReduceTolerances *scaleTolerances =
+      checked[Checked::CH_REDUCEKEYS] ? &tolerances : nullptr;
 
-  if (aniRange.Start() == aniRange.End()) {
-    aniRange.SetEnd(aniRange.End() + ticksPerFrame);
-  }
+  scaleHierarchy.ComputeScales();
+  numKeysWritten +=
+      scaleHierarchy.CommitScales(frameTimesTicks, scaleTolerances);
+  numKeysWritten += scaleHierarchy.ScaleTranslations(frameTimesTicks);
+  profile.Count("keys written", numKeysWritten);
+  profile.Count("motions");
 
+  const Interval aniRange = bake.Range();
   GetCOREInterface()->SetAnimRange(aniRange);
-  return aniRange.End() + ticksPerFrame;
+  importedRanges.push_back(aniRange);
+
+  return bake.sceneGrid.NextStart();
+}
+
+bool MTFImport::PrefetchGrid(const uni::Motion &mot,
+                             revilmax::FrameGrid &grid) {
+  const int32 frameRate = 30 * (frameRateIndex + 1);
+  const int32 sceneTicksPerFrame = checked[Checked::CH_RESAMPLE]
+                                       ? GetTicksPerFrame()
+                                       : revilmax::TICKS_PER_SEC / frameRate;
+  mot.FrameRate(frameRate);
+  grid = revilmax::BuildFrameGrid(
+      mot.Duration(), SampleTicksPerFrame(mot, sceneTicksPerFrame), 0, false);
+
+  return true;
 }
 
 void SwapLocale();
-static struct {
-  revil::LMT asset;
-  std::string filename;
-} lmtCache;
+
+static std::shared_ptr<revil::LMT> FetchLMT(revilmax::AssetCache &cache,
+                                            const std::string &fileName,
+                                            revilmax::ImportProfile &profile) {
+  using Clock = revilmax::ImportProfile::Clock;
+  bool decoded = false;
+  auto asset = cache.Fetch<revil::LMT>(fileName, [&](auto &path) {
+    decoded = true;
+    Clock::time_point begin = Clock::now();
+    revilmax::MappedFile mapped(path);
+    revilmax::MappedStream stream(mapped);
+    BinReaderRef rd(stream);
+    profile.AddPhase("file load", begin);
+    begin = Clock::now();
+    auto lmt = std::make_shared<revil::LMT>();
+    lmt->Load(rd);
+    profile.AddPhase("decode", begin);
+    return lmt;
+  });
+
+  profile.Count(decoded ? "cache misses" : "cache hits");
+
+  return asset;
+}
+
+std::shared_ptr<void> MTFImport::FetchAsset(const std::string &fileName) {
+  return FetchLMT(GetCache(), fileName, profile);
+}
 
 void MTFImport::DoImport(const std::string &fileName, bool suppressPrompts) {
-  if (lmtCache.filename != fileName) {
-    es::Dispose(lmtCache.asset);
-    lmtCache.asset.Load(fileName);
-    lmtCache.filename = fileName;
-  }
+  // Nodes might have been deleted since last import
+  iBoneScanner.scene.Clear();
+  auto asset = FetchLMT(GetCache(), fileName, profile);
 
+  uni::MotionsConst motions = *asset;
   size_t curMotionID = 0;
-  uni::MotionsConst motions = lmtCache.asset;
 
   for (auto &m : *motions) {
     if (m) {
@@ -694,15 +912,29 @@ void MTFImport::DoImport(const std::string &fileName, bool suppressPrompts) {
   instanceDialogType = DLGTYPE_LMT;
 
   if (!suppressPrompts) {
-    if (!SpawnDialog()) {
+    revilmax::ScopedPhase phase(profile, "dialog");
+
+    if (!SpawnDialog(motions.get(), asset)) {
       return;
     }
   }
 
   GetCOREInterface()->ClearNodeSelection();
 
-  iBoneScanner.RescanBones();
-  iBoneScanner.ResetScene();
+  if (checked[Checked::CH_NO_CACHE]) {
+    iBoneScanner.registry.Invalidate();
+  }
+
+  {
+    revilmax::ScopedPhase phase(profile, "scene scan");
+    iBoneScanner.RescanBones();
+  }
+
+  if (!keepScene) {
+    revilmax::ScopedPhase phase(profile, "pose lock/restore");
+    iBoneScanner.ResetScene();
+  }
+
   iBoneScanner.SetIKState(!checked[Checked::CH_DISABLEIK]);
   const int32 frameRate = 30 * (frameRateIndex + 1);
 
@@ -711,6 +943,10 @@ void MTFImport::DoImport(const std::string &fileName, bool suppressPrompts) {
   }
 
   if (checked[Checked::RD_ANISEL]) {
+    if (motionIndex >= motions->Size()) {
+      throw std::out_of_range("Motion index is out of range.");
+    }
+
     auto mot = motions->At(motionIndex);
 
     if (!mot) {
@@ -718,40 +954,56 @@ void MTFImport::DoImport(const std::string &fileName, bool suppressPrompts) {
     }
 
     mot->FrameRate(frameRate);
-    LoadMotion(*mot, 0);
+    LoadMotion(*mot, importStart);
   } else {
-    TimeValue lastTime = 0;
-    size_t i = 0;
-
-    printline("Sequencer not found, dumping animation ranges (in tick units):");
+    // Ranges only depend on durations, so every motion is laid out and
+    // sampled before any key is written.
+    std::vector<uni::Element<const uni::Motion>> loaded;
+    std::vector<MotionBake> bakes;
+    std::vector<size_t> motionIDs;
+    TimeValue lastTime = importStart;
 
-    for (auto &a : *motions) {
+    for (size_t i = 0; i < motions->Size(); i++) {
+      auto a = motions->At(i);
 
       if (!a) {
-        i++;
         continue;
       }
 
       a->FrameRate(frameRate);
+      bakes.emplace_back(LayoutMotion(*a, lastTime));
+      lastTime = bakes.back().sceneGrid.NextStart();
+      motionIDs.push_back(i);
+      loaded.emplace_back(std::move(a));
+    }
+
+    BakeMotions(bakes);
 
-      TimeValue nextTime = LoadMotion(*a.get(), lastTime);
-      es::print::Get() << std::to_string(motionNames[i]) << ": " << lastTime
-                       << ", " << nextTime;
-      const auto &_a = static_cast<const revil::LMTAnimation &>(*a.get());
+    printline("Sequencer not found, dumping animation ranges (in tick units):");
+
+    for (size_t b = 0; b < bakes.size(); b++) {
+      const MotionBake &bake = bakes[b];
+      TimeValue nextTime = LoadMotion(bake);
+      es::print::Get() << std::to_string(motionNames[motionIDs[b]]) << ": "
+                       << bake.sceneGrid.start << ", " << nextTime;
+      const auto &_a = static_cast<const revil::LMTAnimation &>(*bake.motion);
 
       if (_a.LoopFrame() > 0)
         es::print::Get() << ", loopFrame: "
                          << SecToTicks(_a.LoopFrame() / float(frameRate));
 
       es::print::FlushAll();
-      lastTime = nextTime;
+      revilmax::ScopedPhase phase(profile, "pose lock/restore");
       iBoneScanner.LockPose(nextTime - GetTicksPerFrame());
-
-      i++;
     }
   }
 
-  iBoneScanner.RescanBones();
+  {
+    revilmax::ScopedPhase phase(profile, "scene scan");
+    iBoneScanner.RescanBones();
+  }
+
+  revilmax::ScopedPhase phase(profile, "pose lock/restore");
   iBoneScanner.RestoreBasePose(-1);
   iBoneScanner.RestoreIKChains();
 }
@@ -759,17 +1011,18 @@ void MTFImport::DoImport(const std::string &fileName, bool suppressPrompts) {
 int MTFImport::DoImport(const TCHAR *fileName, ImpInterface * /*importerInt*/,
                         Interface * /*ip*/, BOOL suppressPrompts) {
   SwapLocale();
+  revilmax::ScopedFlush flushLog;
 
   TSTRING filename_ = fileName;
 
   try {
     DoImport(std::to_string(filename_), suppressPrompts);
   } catch (const es::InvalidHeaderError &) {
-    lmtCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
     SwapLocale();
     return FALSE;
   } catch (const std::exception &e) {
-    lmtCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
 
     if (suppressPrompts) {
       printerror(e.what());
@@ -779,7 +1032,7 @@ int MTFImport::DoImport(const TCHAR *fileName, ImpInterface * /*importerInt*/,
                  MB_ICONERROR | MB_OK);
     }
   } catch (...) {
-    lmtCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
 
     if (suppressPrompts) {
       printerror("Unhandled exception has been thrown!");
@@ -789,10 +1042,14 @@ int MTFImport::DoImport(const TCHAR *fileName, ImpInterface * /*importerInt*/,
     }
   }
 
+  // Prefetch held selected motion and its asset for import
+  prefetch.Cancel();
+
   if (checked[Checked::CH_NO_CACHE]) {
-    lmtCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
   }
 
+  ReportProfile();
   SwapLocale();
 
   return TRUE;
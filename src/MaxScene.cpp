@@ -0,0 +1,345 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "MaxScene.h"
+#include "datas/tchar.hpp"
+#include <cstring>
+#include <decomp.h>
+#include <iiksys.h>
+
+revilmax::BoneTransform ToBoneTransform(const Matrix3 &mtx) {
+  AffineParts parts;
+  decomp_affine(mtx, &parts);
+
+  revilmax::BoneTransform tm;
+  tm.translation = Vector4A16(parts.t.x, parts.t.y, parts.t.z, 0.f);
+  tm.rotation = Vector4A16(parts.q.x, parts.q.y, parts.q.z, parts.q.w);
+  tm.scale = Vector4A16(parts.k.x, parts.k.y, parts.k.z, 0.f) * parts.f;
+
+  return tm;
+}
+
+Matrix3 ToMatrix3(const revilmax::PoseMatrix &mtx) {
+  auto row = [&](size_t r) {
+    return Point3(mtx.rows[r].X, mtx.rows[r].Y, mtx.rows[r].Z);
+  };
+
+  return Matrix3(row(0), row(1), row(2), row(3));
+}
+
+MaxScene::Node MaxScene::Wrap(INode *node) {
+  auto found = handles.find(node);
+
+  if (found != handles.end()) {
+    return found->second;
+  }
+
+  const Node handle = static_cast<Node>(nodes.size());
+  nodes.push_back(node);
+  handles.emplace(node, handle);
+
+  return handle;
+}
+
+void MaxScene::Clear() {
+  nodes.clear();
+  handles.clear();
+}
+
+MaxScene::Node MaxScene::FindNode(const std::string &name) {
+  const TSTRING nodeName = ToTSTRING(name);
+  INode *node = GetCOREInterface()->GetINodeByName(nodeName.c_str());
+
+  return node ? Wrap(node) : NO_NODE;
+}
+
+MaxScene::Node MaxScene::CreateBone(const std::string &name) {
+  Object *obj = static_cast<Object *>(
+      CreateInstance(HELPER_CLASS_ID, Class_ID(DUMMY_CLASS_ID, 0)));
+  INode *node = GetCOREInterface()->CreateObjectNode(obj);
+  node->ShowBone(2);
+  node->SetWireColor(0x80ff);
+  TSTRING boneName = ToTSTRING(name);
+  node->SetName(ToBoneName(boneName));
+
+  return Wrap(node);
+}
+
+// Current rotation is kept as static value of the new controller
+static void SetSlerpRotation(Control *cnt) {
+  Quat value;
+  value.Identity();
+  Control *oldCnt = cnt->GetRotationController();
+
+  if (oldCnt) {
+    Interval valid = FOREVER;
+    oldCnt->GetValue(0, &value, valid, CTRL_ABSOLUTE);
+  }
+
+  Control *newCnt = static_cast<Control *>(CreateInstance(
+      CTRL_ROTATION_CLASS_ID, Class_ID(LININTERP_ROTATION_CLASS_ID, 0)));
+  newCnt->SetValue(0, &value);
+  cnt->SetRotationController(newCnt);
+}
+
+void MaxScene::PrepareBone(Node node) {
+  Control *cnt = Get(node)->GetTMController();
+
+  if (cnt->GetPositionController()->ClassID() !=
+      Class_ID(LININTERP_POSITION_CLASS_ID, 0))
+    cnt->SetPositionController((Control *)CreateInstance(
+        CTRL_POSITION_CLASS_ID, Class_ID(LININTERP_POSITION_CLASS_ID, 0)));
+
+  if (!IsSlerpRotation(cnt->GetRotationController()))
+    SetSlerpRotation(cnt);
+
+  if (cnt->GetScaleController()->ClassID() !=
+      Class_ID(LININTERP_SCALE_CLASS_ID, 0))
+    cnt->SetScaleController((Control *)CreateInstance(
+        CTRL_SCALE_CLASS_ID, Class_ID(LININTERP_SCALE_CLASS_ID, 0)));
+}
+
+bool MaxScene::HasLinearKeys(Node node, uni::MotionTrack::TrackType_e type) {
+  Control *cnt = Get(node)->GetTMController();
+
+  switch (type) {
+  case uni::MotionTrack::Position:
+    return HasLinearPositionKeys(cnt->GetPositionController(), keyCommitMode);
+  case uni::MotionTrack::Rotation:
+    return IsSlerpRotation(cnt->GetRotationController());
+  case uni::MotionTrack::Scale:
+    return HasLinearScaleKeys(cnt->GetScaleController(), keyCommitMode);
+  default:
+    return false;
+  }
+}
+
+MaxScene::Node MaxScene::Parent(Node node) {
+  INode *parent = Get(node)->GetParentNode();
+
+  return !parent || parent->IsRootNode() ? NO_NODE : Wrap(parent);
+}
+
+void MaxScene::SetParent(Node node, Node parent) {
+  INode *parentNode =
+      parent == NO_NODE ? GetCOREInterface()->GetRootNode() : Get(parent);
+  parentNode->AttachChild(Get(node));
+}
+
+std::vector<MaxScene::Node> MaxScene::Children(Node node) {
+  INode *parent = Get(node);
+  const int numChildren = parent->NumberOfChildren();
+  std::vector<Node> children;
+  children.reserve(numChildren);
+
+  for (int c = 0; c < numChildren; c++) {
+    children.push_back(Wrap(parent->GetChildNode(c)));
+  }
+
+  return children;
+}
+
+// All nodes are cloned by single call, cloning one by one is much slower
+void MaxScene::CloneNodes(const Node *nodes_, size_t numNodes,
+                          const std::string &suffix, Node *clones) {
+  if (!numNodes) {
+    return;
+  }
+
+  INodeTab sourceNodes;
+
+  for (size_t n = 0; n < numNodes; n++) {
+    sourceNodes.AppendNode(Get(nodes_[n]));
+  }
+
+  INodeTab sourceOrder;
+  INodeTab clonedNodes;
+  Point3 offset(0.f, 0.f, 0.f);
+
+  GetCOREInterface()->CloneNodes(sourceNodes, offset, false, NODE_COPY,
+                                 &sourceOrder, &clonedNodes);
+
+  std::unordered_map<INode *, INode *> cloned;
+
+  for (int c = 0; c < sourceOrder.Count(); c++) {
+    cloned[sourceOrder[c]] = clonedNodes[c];
+  }
+
+  const TSTRING tSuffix = ToTSTRING(suffix);
+
+  for (size_t n = 0; n < numNodes; n++) {
+    INode *source = Get(nodes_[n]);
+    INode *clone = cloned[source];
+    TSTRING cloneName = source->GetName();
+    cloneName.append(tSuffix);
+    clone->SetName(ToBoneName(cloneName));
+    source->GetParentNode()->AttachChild(clone);
+    clones[n] = Wrap(clone);
+  }
+}
+
+void MaxScene::SetUserProp(Node node, const std::string &key,
+                           const std::string &value) {
+  const TSTRING tKey = ToTSTRING(key);
+  const TSTRING tValue = ToTSTRING(value);
+  Get(node)->SetUserPropString(tKey.c_str(), tValue.c_str());
+}
+
+bool MaxScene::GetUserProp(Node node, const std::string &key,
+                           std::string &value) {
+  const TSTRING tKey = ToTSTRING(key);
+  INode *nde = Get(node);
+
+  if (!nde->UserPropExists(tKey.c_str())) {
+    return false;
+  }
+
+  MSTR tValue;
+  nde->GetUserPropString(tKey.c_str(), tValue);
+  value = std::to_string(tValue.data());
+
+  return true;
+}
+
+bool MaxScene::GetUserProp(Node node, const std::string &key, int32 &value) {
+  const TSTRING tKey = ToTSTRING(key);
+  int tValue;
+
+  if (!Get(node)->GetUserPropInt(tKey.c_str(), tValue)) {
+    return false;
+  }
+
+  value = tValue;
+
+  return true;
+}
+
+bool MaxScene::GetUserProp(Node node, const std::string &key, bool &value) {
+  const TSTRING tKey = ToTSTRING(key);
+  BOOL tValue;
+
+  if (!Get(node)->GetUserPropBool(tKey.c_str(), tValue)) {
+    return false;
+  }
+
+  value = tValue;
+
+  return true;
+}
+
+bool MaxScene::GetUserData(Node node, uint32 id, std::vector<char> &data) {
+  AppDataChunk *chunk =
+      Get(node)->GetAppDataChunk(dataOwner, SCENE_IMPORT_CLASS_ID, id);
+
+  if (!chunk) {
+    return false;
+  }
+
+  const char *begin = static_cast<const char *>(chunk->data);
+  data.assign(begin, begin + chunk->length);
+
+  return true;
+}
+
+void MaxScene::SetUserData(Node node, uint32 id, const void *data,
+                           size_t size) {
+  // Chunk takes ownership of buffer
+  void *chunkData = MAX_malloc(size);
+  memcpy(chunkData, data, size);
+  ClearUserData(node, id);
+  Get(node)->AddAppDataChunk(dataOwner, SCENE_IMPORT_CLASS_ID, id,
+                             static_cast<DWORD>(size), chunkData);
+}
+
+void MaxScene::ClearUserData(Node node, uint32 id) {
+  Get(node)->RemoveAppDataChunk(dataOwner, SCENE_IMPORT_CLASS_ID, id);
+}
+
+void MaxScene::SetIKEnabled(Node node, bool enabled) {
+  Control *ikCnt = Get(node)->GetTMController();
+
+  if (ikCnt->ClassID() != IKCHAINCONTROL_CLASS_ID) {
+    return;
+  }
+
+  IParamBlock2 *bck = ikCnt->GetParamBlock(IIKChainControl::kParamBlock);
+  bck->SetValue(IIKChainControl::kAutoSnap, 0, 0);
+  Control *enableCnt =
+      static_cast<Control *>(ikCnt->GetReference(IIKChainControl::kEnableRef));
+  BOOL iEnabled = enabled;
+  enableCnt->SetValue(0, &iEnabled);
+}
+
+revilmax::BoneTransform MaxScene::LocalTransform(Node node, int32 time) {
+  Matrix3 mtx(1);
+  Interval valid = FOREVER;
+  Get(node)->GetTMController()->GetValue(time, &mtx, valid, CTRL_RELATIVE);
+
+  return ToBoneTransform(mtx);
+}
+
+void MaxScene::SetLocalTransform(Node node, int32 time,
+                                 const revilmax::BoneTransform &tm) {
+  SetXFormPacket packet(ToMatrix3(revilmax::ToPoseMatrix(tm)));
+  AnimateOn();
+  Get(node)->GetTMController()->SetValue(time, &packet);
+  AnimateOff();
+}
+
+void MaxScene::CommitKeys(Node node, uni::MotionTrack::TrackType_e type,
+                          const int32 *times, const Vector4A16 *values,
+                          size_t numKeys) {
+  Control *cnt = Get(node)->GetTMController();
+
+  switch (type) {
+  case uni::MotionTrack::Position:
+  case uni::MotionTrack::Scale: {
+    points.resize(numKeys);
+
+    for (size_t k = 0; k < numKeys; k++) {
+      points[k] = Point3(values[k].X, values[k].Y, values[k].Z);
+    }
+
+    if (type == uni::MotionTrack::Position) {
+      CommitPositionKeys(cnt->GetPositionController(), times, points.data(),
+                         numKeys, keyCommitMode);
+    } else {
+      CommitScaleKeys(cnt->GetScaleController(), times, points.data(),
+                      numKeys, keyCommitMode);
+    }
+    break;
+  }
+
+  case uni::MotionTrack::Rotation:
+    CommitRotationKeys(cnt->GetRotationController(), times,
+                       reinterpret_cast<const Quat *>(values), numKeys,
+                       keyCommitMode);
+    break;
+
+  default:
+    break;
+  }
+}
+
+void MaxScene::DeleteKeys(Node node) {
+  Control *cnt = Get(node)->GetTMController();
+  cnt->GetScaleController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
+  cnt->GetRotationController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
+  cnt->GetPositionController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
+}
@@ -0,0 +1,80 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "3DSMaxSDKCompat.h"
+#include "KeyCommit.h"
+#include "SceneBackend.h"
+#include <inode.h>
+#include <unordered_map>
+#include <vector>
+
+revilmax::BoneTransform ToBoneTransform(const Matrix3 &mtx);
+Matrix3 ToMatrix3(const revilmax::PoseMatrix &mtx);
+
+// SceneBackend over 3ds Max scene.
+// Handles are never released, Clear must be called before nodes can be
+// deleted, usually at the start of every import.
+// User data is stored as AppData chunks owned by importer class dataOwner.
+class MaxScene : public revilmax::SceneBackend {
+public:
+  KeyCommitMode keyCommitMode = KeyCommitMode::KeyControl;
+
+  MaxScene() = default;
+  explicit MaxScene(Class_ID dataOwner_) : dataOwner(dataOwner_) {}
+
+  // Handle of node, node is added if not wrapped yet
+  Node Wrap(INode *node);
+  INode *Get(Node node) const { return nodes[node]; }
+  void Clear();
+
+  Node FindNode(const std::string &name) override;
+  Node CreateBone(const std::string &name) override;
+  void PrepareBone(Node node) override;
+  bool HasLinearKeys(Node node, uni::MotionTrack::TrackType_e type) override;
+  Node Parent(Node node) override;
+  void SetParent(Node node, Node parent) override;
+  std::vector<Node> Children(Node node) override;
+  void CloneNodes(const Node *nodes, size_t numNodes,
+                  const std::string &suffix, Node *clones) override;
+  void SetUserProp(Node node, const std::string &key,
+                   const std::string &value) override;
+  bool GetUserProp(Node node, const std::string &key,
+                   std::string &value) override;
+  bool GetUserProp(Node node, const std::string &key, int32 &value) override;
+  bool GetUserProp(Node node, const std::string &key, bool &value) override;
+  bool GetUserData(Node node, uint32 id, std::vector<char> &data) override;
+  void SetUserData(Node node, uint32 id, const void *data,
+                   size_t size) override;
+  void ClearUserData(Node node, uint32 id) override;
+  void SetIKEnabled(Node node, bool enabled) override;
+  revilmax::BoneTransform LocalTransform(Node node, int32 time) override;
+  void SetLocalTransform(Node node, int32 time,
+                         const revilmax::BoneTransform &tm) override;
+  void CommitKeys(Node node, uni::MotionTrack::TrackType_e type,
+                  const int32 *times, const Vector4A16 *values,
+                  size_t numKeys) override;
+  void DeleteKeys(Node node) override;
+
+private:
+  Class_ID dataOwner;
+  std::vector<INode *> nodes;
+  std::unordered_map<INode *, Node> handles;
+  std::vector<Point3> points;
+};
@@ -17,22 +17,30 @@
     Revil Tool uses RevilLib 2017-2020 Lukas Cone
 */
 
+#include "BatchImport.h"
+#include "BoneRegistry.h"
+#include "LogSink.h"
+#include "MappedFile.h"
+#include "MaxScene.h"
+#include "MotionSampler.h"
 #include "RevilMax.h"
+#include "SceneCommit.h"
+#include "datas/binreader_stream.hpp"
 #include "datas/except.hpp"
 #include "datas/master_printer.hpp"
 #include "datas/tchar.hpp"
 #include "revil/re_asset.hpp"
 #include "uni/motion.hpp"
-#include "uni/rts.hpp"
 #include "uni/skeleton.hpp"
 #include <array>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 
 #define REEngineImport_CLASS_ID Class_ID(0x373d264a, 0x90c37b7)
 static const TCHAR _className[] = _T("REEngineImport");
 
-class REEngineImport : public SceneImport, RevilMax {
+class REEngineImport : public SceneImport, public RevilMax {
 public:
   // Constructor/Destructor
   REEngineImport();
@@ -49,12 +57,27 @@ public:
   void ShowAbout(HWND hWnd) override; // Show DLL's "About..." box
   int DoImport(const TCHAR *name, ImpInterface *i, Interface *gi,
                BOOL suppressPrompts = FALSE) override;
-  void DoImport(const std::string &fileName, bool suppressPrompts);
+  void DoImport(const std::string &fileName, bool suppressPrompts) override;
+  std::shared_ptr<void> FetchAsset(const std::string &fileName) override;
 
-  std::unordered_map<uint32, INode *> nodes;
+  revilmax::BoneNodes nodes;
 
   void LoadSkeleton(const uni::Skeleton *skel, TimeValue startTime = 0);
+  // Motion's own frame spacing unless resampled to scene frame rate
+  int32 SceneTicksPerFrame(const uni::Motion &mot) const;
+  // Places motion on timeline at startTime, nothing is sampled yet
+  MotionBake LayoutMotion(const uni::Motion *mot, TimeValue startTime);
+  void BakeMotion(MotionBake &bake) override;
+  void CommitMotion(const revilmax::MotionSamples &samples,
+                    const revilmax::FrameGrid &grid);
+  // Writes baked samples as keys, returns start of the next motion
+  TimeValue LoadMotion(const MotionBake &bake);
   TimeValue LoadMotion(const uni::Motion *mot, TimeValue startTime = 0);
+  bool PrefetchGrid(const uni::Motion &mot,
+                    revilmax::FrameGrid &grid) override;
+#ifdef REVILMAX_COMMIT_BENCHMARK
+  void BenchmarkCommit(const uni::Motion *mot);
+#endif
 };
 
 class : public ClassDesc2 {
@@ -72,6 +95,16 @@ public:
 
 ClassDesc2 *GetREEngineImportDesc() { return &REEngineImportDesc; }
 
+std::unique_ptr<RevilMax> CreateREBatchImporter(const std::string &fileName) {
+  auto importer = std::make_unique<REEngineImport>();
+
+  if (!HandlesExtension(*importer, fileName)) {
+    return {};
+  }
+
+  return importer;
+}
+
 //--- HavokImp -------------------------------------------------------
 REEngineImport::REEngineImport() {}
 
@@ -125,246 +158,215 @@ unsigned int REEngineImport::Version() { return REVILMAX_VERSIONINT; }
 
 void REEngineImport::ShowAbout(HWND hWnd) { ShowAboutDLG(hWnd); }
 
-static class : public ITreeEnumProc {
+static class {
 public:
   const MSTR boneNameHint = _T("BoneHash");
+  BoneRegistry registry{_T("BoneHash")};
 
-  std::vector<INode *> bones;
+  MaxScene scene;
+  std::vector<MaxScene::Node> bones;
+  revilmax::ScenePose pose;
 
   void RescanBones() {
     bones.clear();
-    GetCOREInterface7()->GetScene()->EnumTree(this);
-  }
 
-  void LockPose(TimeValue atTime) {
-    for (auto &b : bones) {
-      Matrix3 pMat = b->GetParentTM(atTime);
-      pMat.Invert();
-      Matrix3 mtx = b->GetNodeTM(atTime) * pMat;
-      SetXFormPacket packet(mtx);
-      AnimateOn();
-      b->GetTMController()->SetValue(atTime, &packet);
-      AnimateOff();
+    for (auto n : registry.Nodes()) {
+      bones.push_back(scene.Wrap(n));
     }
+
+    pose.Build(scene, bones);
   }
 
+  // Keys last committed pose, so next motion doesn't blend into this one
+  void LockPose(TimeValue atTime) { pose.KeyEndPose(atTime); }
+
   void ResetScene() {
     SuspendAnimate();
 
-    for (auto &n : bones) {
-      Matrix3 pMat = n->GetParentTM(-1);
-      pMat.Invert();
-      Matrix3 mtx = n->GetNodeTM(-1) * pMat;
-      SetXFormPacket packet(mtx);
-      Control *cnt = n->GetTMController();
-      cnt->GetScaleController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
-      cnt->GetRotationController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
-      cnt->GetPositionController()->DeleteKeys(TRACK_DOALL | TRACK_RIGHTTOLEFT);
-      AnimateOn();
-      n->GetTMController()->SetValue(-1, &packet);
-      AnimateOff();
-    }
-  }
-
-  int callback(INode *node) {
-    if (node->UserPropExists(boneNameHint)) {
-      bones.push_back(node);
+    for (auto n : bones) {
+      scene.DeleteKeys(n);
     }
 
-    return TREE_CONTINUE;
+    // Rest pose was read from controllers by RescanBones
+    pose.KeyRestPose(-1);
   }
 } REBoneScanner;
 
 void REEngineImport::LoadSkeleton(const uni::Skeleton *skel,
                                   TimeValue startTime) {
-  for (auto &b : *skel) {
-    TSTRING boneName = ToTSTRING(b->Name());
-    INode *node = GetCOREInterface()->GetINodeByName(boneName.c_str());
-
-    if (!node) {
-      if (checked[Checked::CH_ADDITIVE]) {
-        if (!checked[Checked::CH_NOLOGBONES]) {
-          printerror("Cannot find bone: " << b->Name());
-        }
-        continue;
-      }
-      Object *obj = static_cast<Object *>(
-          CreateInstance(HELPER_CLASS_ID, Class_ID(DUMMY_CLASS_ID, 0)));
-      node = GetCOREInterface()->CreateObjectNode(obj);
-      node->ShowBone(2);
-      node->SetWireColor(0x80ff);
-      node->SetName(ToBoneName(boneName));
-    }
-
-    uni::RTSValue boneTM;
-    b->GetTM(boneTM);
-
-    Matrix3 nodeTM;
-    nodeTM.SetRotate(
-        reinterpret_cast<const Quat &>(boneTM.rotation.QConjugate()));
-    nodeTM.SetTrans(
-        reinterpret_cast<const Point3 &>(boneTM.translation * objectScale));
-
-    auto parentBone = b->Parent();
-
-    if (parentBone && !checked[Checked::CH_ADDITIVE]) {
-      INode *pNode = nodes[parentBone->Index()];
-
-      pNode->AttachChild(node);
-    } else if (checked[Checked::CH_ADDITIVE]) {
-      Matrix3 pMat = node->GetParentTM(-1);
-      pMat.Invert();
-      nodeTM = node->GetNodeTM(-1) * pMat;
-    } else {
-      nodeTM *= corMat;
-    }
+  revilmax::SkeletonImportSettings settings;
+  settings.scale = objectScale;
+  settings.additive = checked[Checked::CH_ADDITIVE];
+  settings.logMissingBones = !checked[Checked::CH_NOLOGBONES];
+  revilmax::ImportSkeleton(REBoneScanner.scene, *skel, startTime, settings,
+                           nodes);
+
+  for (auto &n : nodes) {
+    REBoneScanner.registry.Register(REBoneScanner.scene.Get(n.second));
+  }
+}
 
-    Control *cnt = node->GetTMController();
+int32 REEngineImport::SceneTicksPerFrame(const uni::Motion &mot) const {
+  const uint32 frameRate = mot.FrameRate();
 
-    if (cnt->GetPositionController()->ClassID() !=
-        Class_ID(LININTERP_POSITION_CLASS_ID, 0))
-      cnt->SetPositionController((Control *)CreateInstance(
-          CTRL_POSITION_CLASS_ID, Class_ID(LININTERP_POSITION_CLASS_ID, 0)));
+  if (checked[Checked::CH_RESAMPLE] || !frameRate) {
+    return GetTicksPerFrame();
+  }
 
-    if (cnt->GetRotationController()->ClassID() !=
-        Class_ID(EULER_CONTROL_CLASS_ID, 0))
-      cnt->SetRotationController((Control *)CreateInstance(
-          CTRL_ROTATION_CLASS_ID, Class_ID(EULER_CONTROL_CLASS_ID, 0)));
+  return revilmax::TICKS_PER_SEC / frameRate;
+}
 
-    if (cnt->GetScaleController()->ClassID() !=
-        Class_ID(LININTERP_SCALE_CLASS_ID, 0))
-      cnt->SetScaleController((Control *)CreateInstance(
-          CTRL_SCALE_CLASS_ID, Class_ID(LININTERP_SCALE_CLASS_ID, 0)));
+MotionBake REEngineImport::LayoutMotion(const uni::Motion *mot,
+                                        TimeValue startTime) {
+  const int32 sceneTicksPerFrame = SceneTicksPerFrame(*mot);
+  MotionBake bake;
+  bake.motion = mot;
+  bake.sceneGrid = revilmax::BuildFrameGrid(
+      mot->Duration(), sceneTicksPerFrame, startTime, true);
+  bake.grid = revilmax::BuildFrameGrid(
+      mot->Duration(), SampleTicksPerFrame(*mot, sceneTicksPerFrame),
+      startTime, true);
+
+  return bake;
+}
 
-    AnimateOn();
-    SetXFormPacket packet(nodeTM);
-    node->GetTMController()->SetValue(startTime, &packet);
-    node->GetTMController()->SetValue(-1, &packet);
-    AnimateOff();
+void REEngineImport::BakeMotion(MotionBake &bake) {
+  bake.samples = SampleMotion(*bake.motion, bake.grid);
 
-    node->SetUserPropString(REBoneScanner.boneNameHint,
-                            ToTSTRING(b->Index()).data());
-    nodes[b->Index()] = node;
+  // Rotations are reduced even without key reduction, keying every frame is
+  // expensive. Reduced keys go to slerp controllers, so they stay within
+  // rotationTolerance of sampled rotation.
+  if (!checked[Checked::CH_REDUCEKEYS] && !checked[Checked::CH_NATIVEKEYS]) {
+    revilmax::ScopedPhase phase(profile, "rotation reduction");
+    revilmax::ReduceRotations(bake.samples, rotationTolerance, GetPool());
   }
 }
 
-TimeValue REEngineImport::LoadMotion(const uni::Motion *mot,
-                                     TimeValue startTime) {
-  if (!checked[Checked::CH_RESAMPLE]) {
-    SetFrameRate(mot->FrameRate());
-  }
-
-  const float aDuration = mot->Duration();
-  const TimeValue ticksPerFrame = GetTicksPerFrame();
-  TimeValue numTicks = SecToTicks(aDuration) + ticksPerFrame;
-  TimeValue overlappingTicks = numTicks % ticksPerFrame;
+void REEngineImport::CommitMotion(const revilmax::MotionSamples &samples,
+                                  const revilmax::FrameGrid &grid) {
+  revilmax::ScopedPhase phase(profile, "key commit");
+  MaxScene &scene = REBoneScanner.scene;
+  scene.keyCommitMode = keyCommitMode;
+  const revilmax::CommitStats stats = revilmax::CommitSamples(
+      scene, samples, grid, nodes, &REBoneScanner.pose);
 
-  if (overlappingTicks > (ticksPerFrame / 2)) {
-    numTicks += ticksPerFrame - overlappingTicks;
-  } else {
-    numTicks -= overlappingTicks;
+  if (stats.numSkippedTracks) {
+    profile.Count("tracks skipped", stats.numSkippedTracks);
   }
 
-  Interval aniRange(startTime, startTime + numTicks - ticksPerFrame);
-  std::vector<float> frameTimes;
-  std::vector<TimeValue> frameTimesTicks;
-
-  for (TimeValue v = aniRange.Start(); v <= aniRange.End();
-       v += ticksPerFrame) {
-    frameTimes.push_back(TicksToSec(v - startTime));
-    frameTimesTicks.push_back(v);
+  if (stats.numUnreducedTracks) {
+    profile.Count("tracks unreduced", stats.numUnreducedTracks);
   }
 
-  if (aniRange.Start() == aniRange.End()) {
-    aniRange.SetEnd(aniRange.End() + ticksPerFrame);
+  for (auto &v : samples) {
+    if (v.trackType == uni::MotionTrack::Rotation) {
+      profile.Count("rotation frames", v.values.size());
+    }
   }
 
-  GetCOREInterface()->SetAnimRange(aniRange);
-
-  size_t numFrames = frameTimes.size();
+  profile.Count("rotation keys", stats.numRotationKeys);
 
-  for (auto &v : *mot) {
-    if (!nodes.count(v->BoneIndex()))
-      continue;
-
-    INode *node = nodes[v->BoneIndex()];
-    Control *cnt = node->GetTMController();
+  profile.Count("keys written", stats.numKeys);
+}
 
-    switch (v->TrackType()) {
-    case uni::MotionTrack::Position: {
-      Control *posControl = cnt->GetPositionController();
+bool REEngineImport::PrefetchGrid(const uni::Motion &mot,
+                                  revilmax::FrameGrid &grid) {
+  const uint32 frameRate = mot.FrameRate();
 
-      AnimateOn();
+  if (!checked[Checked::CH_RESAMPLE] && !frameRate) {
+    return false;
+  }
 
-      for (int i = 0; i < numFrames; i++) {
-        Vector4A16 cVal;
-        v->GetValue(cVal, frameTimes[i]);
-        cVal *= objectScale;
-        Point3 kVal = reinterpret_cast<Point3 &>(cVal);
+  grid = revilmax::BuildFrameGrid(
+      mot.Duration(), SampleTicksPerFrame(mot, SceneTicksPerFrame(mot)), 0,
+      true);
 
-        if (node->GetParentNode()->IsRootNode())
-          kVal = corMat.PointTransform(kVal);
+  return true;
+}
 
-        posControl->SetValue(frameTimesTicks[i], &kVal);
-      }
+TimeValue REEngineImport::LoadMotion(const MotionBake &bake) {
+  if (!checked[Checked::CH_RESAMPLE] && bake.motion->FrameRate()) {
+    SetFrameRate(bake.motion->FrameRate());
+  }
 
-      AnimateOff();
-      break;
-    }
+  const Interval aniRange = bake.Range();
+  GetCOREInterface()->SetAnimRange(aniRange);
+  importedRanges.push_back(aniRange);
+  CommitMotion(bake.samples, bake.grid);
+  profile.Count("motions");
 
-    case uni::MotionTrack::Rotation: {
-      Control *rotControl = cnt->GetRotationController();
+  return bake.sceneGrid.NextStart();
+}
 
-      AnimateOn();
+TimeValue REEngineImport::LoadMotion(const uni::Motion *mot,
+                                     TimeValue startTime) {
+  MotionBake bake = LayoutMotion(mot, startTime);
+  BakeMotion(bake);
 
-      for (int i = 0; i < numFrames; i++) {
-        if (i % 3 != 0) {
-          continue;
-        }
-        Vector4A16 cVal;
-        v->GetValue(cVal, frameTimes[i]);
-        Quat kVal = reinterpret_cast<Quat &>(cVal.QConjugate());
-
-        if (node->GetParentNode()->IsRootNode()) {
-          Matrix3 cMat;
-          cMat.SetRotate(kVal);
-          kVal = cMat * corMat;
-        }
+  return LoadMotion(bake);
+}
 
-        rotControl->SetValue(frameTimesTicks[i], &kVal);
+#ifdef REVILMAX_COMMIT_BENCHMARK
+void REEngineImport::BenchmarkCommit(const uni::Motion *mot) {
+  LoadMotion(mot);
+
+  MotionBake bake = LayoutMotion(mot, 0);
+  BakeMotion(bake);
+  const revilmax::MotionSamples &samples = bake.samples;
+  size_t numKeys = 0;
+
+  for (auto &v : samples)
+    numKeys += v.NumKeys();
+
+  struct Backend {
+    KeyCommitMode mode;
+    // Euler XYZ rotation like on MTF rigs, reduced rotations are keyed at
+    // every frame through euler key tables
+    bool euler;
+    const char *name;
+  };
+
+  const Backend backends[]{
+      {KeyCommitMode::SetValue, false, "SetValue"},
+      {KeyCommitMode::KeyControl, false, "IKeyControl"},
+      {KeyCommitMode::SetValue, true, "SetValue, euler"},
+      {KeyCommitMode::KeyControl, true, "IKeyControl, euler"},
+  };
+
+  printline("Key commit benchmark, " << samples.size() << " tracks, "
+                                     << numKeys << " reduced keys:");
+  MaxScene &scene = REBoneScanner.scene;
+
+  for (auto &b : backends) {
+    REBoneScanner.RescanBones();
+
+    for (auto n : REBoneScanner.bones) {
+      if (b.euler) {
+        scene.Get(n)->GetTMController()->SetRotationController(
+            static_cast<Control *>(CreateInstance(
+                CTRL_ROTATION_CLASS_ID, Class_ID(EULER_CONTROL_CLASS_ID, 0))));
+      } else {
+        scene.PrepareBone(n);
       }
-
-      AnimateOff();
-      break;
     }
 
-    case uni::MotionTrack::Scale: {
-      Control *sclControl = cnt->GetScaleController();
-
-      AnimateOn();
-
-      for (int i = 0; i < numFrames; i++) {
-        Vector4A16 cVal;
-        v->GetValue(cVal, frameTimes[i]);
-        Point3 kVal = reinterpret_cast<Point3 &>(cVal);
-
-        if (node->GetParentNode()->IsRootNode())
-          kVal = corMat.PointTransform(kVal);
-
-        sclControl->SetValue(frameTimesTicks[i], &kVal);
-      }
-
-      AnimateOff();
-      break;
-    }
+    REBoneScanner.ResetScene();
+    keyCommitMode = b.mode;
+    const auto tStart = std::chrono::steady_clock::now();
+    CommitMotion(samples, bake.grid);
+    const auto tEnd = std::chrono::steady_clock::now();
+    const auto durationMs =
+        std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+    printline("  " << b.name << ": " << durationMs << " ms");
+  }
 
-    default:
-      break;
-    }
+  for (auto n : REBoneScanner.bones) {
+    scene.PrepareBone(n);
   }
 
-  return aniRange.End() + ticksPerFrame;
+  keyCommitMode = KeyCommitMode::KeyControl;
 }
+#endif
 
 void SwapLocale() {
   static std::string oldLocale;
@@ -378,20 +380,44 @@ void SwapLocale() {
   }
 }
 
-static struct {
-  revil::REAsset asset;
-  std::string filename;
-} areCache;
+static std::shared_ptr<revil::REAsset>
+FetchREAsset(revilmax::AssetCache &cache, const std::string &fileName,
+             revilmax::ImportProfile &profile) {
+  using Clock = revilmax::ImportProfile::Clock;
+  bool decoded = false;
+  auto asset = cache.Fetch<revil::REAsset>(fileName, [&](auto &path) {
+    decoded = true;
+    Clock::time_point begin = Clock::now();
+    revilmax::MappedFile mapped(path);
+    revilmax::MappedStream stream(mapped);
+    BinReaderRef rd(stream);
+    profile.AddPhase("file load", begin);
+    begin = Clock::now();
+    auto reAsset = std::make_shared<revil::REAsset>();
+    reAsset->Load(rd);
+    profile.AddPhase("decode", begin);
+
+    return reAsset;
+  });
+
+  profile.Count(decoded ? "cache misses" : "cache hits");
+
+  return asset;
+}
+
+std::shared_ptr<void>
+REEngineImport::FetchAsset(const std::string &fileName) {
+  return FetchREAsset(GetCache(), fileName, profile);
+}
 
 void REEngineImport::DoImport(const std::string &fileName,
                               bool suppressPrompts) {
-  if (areCache.filename != fileName) {
-    areCache.asset.Load(fileName);
-    areCache.filename = fileName;
-  }
-
-  auto motionList = areCache.asset.As<uni::MotionsConst>();
-  auto skelList = areCache.asset.As<uni::SkeletonsConst>();
+  // Nodes might have been deleted since last import
+  REBoneScanner.scene.Clear();
+  nodes.clear();
+  auto asset = FetchREAsset(GetCache(), fileName, profile);
+  auto motionList = asset->As<uni::MotionsConst>();
+  auto skelList = asset->As<uni::SkeletonsConst>();
   uni::Element<const uni::Motion> cMotion;
   auto skel = motionList->Size() > skelList->Size() ? skelList->At(0) : nullptr;
 
@@ -403,39 +429,67 @@ void REEngineImport::DoImport(const std::string &fileName,
     }
 
     if (!suppressPrompts) {
-      if (!SpawnDialog()) {
+      revilmax::ScopedPhase phase(profile, "dialog");
+
+      if (!SpawnDialog(motionList.get(), asset)) {
         return;
       }
     }
 
+    if (checked[Checked::CH_NO_CACHE]) {
+      REBoneScanner.registry.Invalidate();
+    }
+
     if (checked[Checked::RD_ANISEL]) {
+      if (motionIndex >= motionList->Size()) {
+        throw std::out_of_range("Motion index is out of range.");
+      }
+
       cMotion = std::move(motionList->At(motionIndex));
 
       if (!skel && skelList->Size()) {
         skel = skelList->At(motionIndex);
       }
     } else {
-      TimeValue lastTime = 0;
-      int i = 0;
+      // Ranges only depend on durations, so every motion is laid out and
+      // sampled before any key is written.
+      std::vector<uni::Element<const uni::Motion>> loaded;
+      std::vector<MotionBake> bakes;
+      TimeValue lastTime = importStart;
+
+      for (size_t i = 0; i < motionList->Size(); i++) {
+        auto m = motionList->At(i);
+        bakes.emplace_back(LayoutMotion(m.get(), lastTime));
+        lastTime = bakes.back().sceneGrid.NextStart();
+        loaded.emplace_back(std::move(m));
+      }
+
+      BakeMotions(bakes);
 
       printline(
           "Sequencer not found, dumping animation ranges (in tick units):");
 
-      for (auto &m : *motionList) {
+      for (size_t i = 0; i < bakes.size(); i++) {
+        const MotionBake &bake = bakes[i];
+
         if (skelList->Size()) {
           auto _skel =
               skel ? decltype(skel){skel.get(), false} : skelList->At(i);
 
-          LoadSkeleton(_skel.get(), lastTime);
+          revilmax::ScopedPhase phase(profile, "skeleton build");
+          LoadSkeleton(_skel.get(), bake.sceneGrid.start);
         }
 
-        TimeValue nextTime = LoadMotion(m.get(), lastTime);
+        {
+          revilmax::ScopedPhase phase(profile, "scene scan");
+          REBoneScanner.RescanBones();
+        }
+
+        TimeValue nextTime = LoadMotion(bake);
         printline(std::to_string(motionNames[i])
-                  << ": " << lastTime << ", " << nextTime);
-        lastTime = nextTime;
-        REBoneScanner.RescanBones();
-        REBoneScanner.LockPose(lastTime - GetTicksPerFrame());
-        i++;
+                  << ": " << bake.sceneGrid.start << ", " << nextTime);
+        revilmax::ScopedPhase phase(profile, "pose lock/restore");
+        REBoneScanner.LockPose(nextTime - GetTicksPerFrame());
       }
 
       return;
@@ -443,7 +497,12 @@ void REEngineImport::DoImport(const std::string &fileName,
   }
 
   if (!cMotion) {
-    cMotion = areCache.asset.As<uni::Element<const uni::Motion>>();
+    // Single motion file, no dialog was shown
+    cMotion = asset->As<uni::Element<const uni::Motion>>();
+
+    if (checked[Checked::CH_NO_CACHE]) {
+      REBoneScanner.registry.Invalidate();
+    }
   }
 
   if (!cMotion) {
@@ -451,29 +510,42 @@ void REEngineImport::DoImport(const std::string &fileName,
   }
 
   if (skel) {
-    LoadSkeleton(skel.get());
+    revilmax::ScopedPhase phase(profile, "skeleton build");
+    LoadSkeleton(skel.get(), importStart);
   }
 
-  REBoneScanner.RescanBones();
-  REBoneScanner.ResetScene();
+  {
+    revilmax::ScopedPhase phase(profile, "scene scan");
+    REBoneScanner.RescanBones();
+  }
 
-  LoadMotion(cMotion.get());
+  if (!keepScene) {
+    revilmax::ScopedPhase phase(profile, "pose lock/restore");
+    REBoneScanner.ResetScene();
+  }
+
+#ifdef REVILMAX_COMMIT_BENCHMARK
+  BenchmarkCommit(cMotion.get());
+#else
+  LoadMotion(cMotion.get(), importStart);
+#endif
 }
 
 int REEngineImport::DoImport(const TCHAR *fileName,
                              ImpInterface * /*importerInt*/, Interface * /*ip*/,
                              BOOL suppressPrompts) {
   SwapLocale();
+  revilmax::ScopedFlush flushLog;
   TSTRING filename_ = fileName;
 
   try {
     DoImport(std::to_string(filename_), suppressPrompts);
   } catch (const es::InvalidHeaderError &) {
-    areCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
     SwapLocale();
     return FALSE;
   } catch (const std::exception &e) {
-    areCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
 
     if (suppressPrompts) {
       printerror(e.what());
@@ -483,7 +555,7 @@ int REEngineImport::DoImport(const TCHAR *fileName,
                  MB_ICONERROR | MB_OK);
     }
   } catch (...) {
-    areCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
 
     if (suppressPrompts) {
       printerror("Unhandled exception has been thrown!");
@@ -493,10 +565,14 @@ int REEngineImport::DoImport(const TCHAR *fileName,
     }
   }
 
+  // Prefetch held selected motion and its asset for import
+  prefetch.Cancel();
+
   if (checked[Checked::CH_NO_CACHE]) {
-    areCache.filename.clear();
+    GetCache().Erase(std::to_string(filename_));
   }
 
+  ReportProfile();
   SwapLocale();
 
   return TRUE;
@@ -19,6 +19,7 @@
 
 #include "RevilMax.h"
 #include "datas/directory_scanner.hpp"
+#include "datas/master_printer.hpp"
 #include "datas/reflector_xml.hpp"
 #include "pugixml.hpp"
 #include "resource.h"
@@ -28,6 +29,7 @@
 #include <IPathConfigMgr.h>
 #include <array>
 #include <commctrl.h>
+#include <fstream>
 #include <iparamm2.h>
 
 extern HINSTANCE hInstance;
@@ -43,20 +45,31 @@ const TCHAR _homePage[] =
 #include "win/AboutDlg.h"
 
 RevilMax::RevilMax()
-    : hWnd(nullptr), comboHandle(nullptr), objectScale(1.0f), motionIndex(),
-      frameRateIndex(1), checked(Checked::RD_ANISEL),
+    : hWnd(nullptr), comboHandle(nullptr), objectScale(1.0f),
+      positionTolerance(0.01f), rotationTolerance(0.1f),
+      scaleTolerance(0.001f), motionIndex(), frameRateIndex(1),
+      cacheBudget(512), profileImport(false), profileTrace(false),
+      checked(Checked::RD_ANISEL),
       visible(Visible::CB_MOTION) {
   RegisterReflectedTypes<Visible, Checked>();
 }
 
 REFLECT(CLASS(RevilMax), MEMBER(objectScale), MEMBER(motionIndex),
-        MEMBER(frameRateIndex), MEMBER(checked), MEMBER(visible));
+        MEMBER(frameRateIndex), MEMBER(checked), MEMBER(visible),
+        MEMBER(positionTolerance), MEMBER(rotationTolerance),
+        MEMBER(scaleTolerance), MEMBER(cacheBudget), MEMBER(profileImport),
+        MEMBER(profileTrace));
 
 static auto GetConfig() {
   TSTRING cfgpath = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
   return cfgpath + _T("/RevilMaxSettings.xml");
 }
 
+static auto GetTracePath() {
+  TSTRING cfgpath = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
+  return cfgpath + _T("/RevilMaxTrace.json");
+}
+
 void RevilMax::LoadCFG() {
   pugi::xml_document doc;
   auto conf = GetConfig();
@@ -70,6 +83,9 @@ void RevilMax::LoadCFG() {
   CheckDlgButton(hWnd, IDC_CH_NO_CACHE, checked[Checked::CH_NO_CACHE]);
   CheckDlgButton(hWnd, IDC_CH_NOLOGBONES, checked[Checked::CH_NOLOGBONES]);
   CheckDlgButton(hWnd, IDC_CH_RESAMPLE, checked[Checked::CH_RESAMPLE]);
+  CheckDlgButton(hWnd, IDC_CH_MULTITHREAD, checked[Checked::CH_MULTITHREAD]);
+  CheckDlgButton(hWnd, IDC_CH_REDUCEKEYS, checked[Checked::CH_REDUCEKEYS]);
+  CheckDlgButton(hWnd, IDC_CH_NATIVEKEYS, checked[Checked::CH_NATIVEKEYS]);
   CheckDlgButton(hWnd, IDC_RD_ANIALL, checked[Checked::RD_ANIALL]);
   CheckDlgButton(hWnd, IDC_RD_ANISEL, checked[Checked::RD_ANISEL]);
   EnableWindow(comboHandle, visible[Visible::CB_MOTION]);
@@ -97,6 +113,12 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
     imp->LoadCFG();
     SetupIntSpinner(hWnd, IDC_SPIN_SCALE, IDC_EDIT_SCALE, 0, 5000,
                     imp->objectScale);
+    SetupFloatSpinner(hWnd, IDC_SPIN_POSTOL, IDC_EDIT_POSTOL, 0.f, 100.f,
+                      imp->positionTolerance, 0.001f);
+    SetupFloatSpinner(hWnd, IDC_SPIN_ROTTOL, IDC_EDIT_ROTTOL, 0.f, 180.f,
+                      imp->rotationTolerance, 0.01f);
+    SetupFloatSpinner(hWnd, IDC_SPIN_SCLTOL, IDC_EDIT_SCLTOL, 0.f, 1.f,
+                      imp->scaleTolerance, 0.0001f);
     SetWindowText(hWnd, _T("Revil Motion Import v" RevilMax_VERSION));
 
     if (imp->instanceDialogType == RevilMax::DLGTYPE_LMT) {
@@ -136,6 +158,7 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
       SendMessage(imp->comboHandle, CB_SETCURSEL, imp->motionIndex, 0);
 
       EnableWindow(imp->comboHandle, imp->visible[Visible::CB_MOTION]);
+      imp->PrefetchMotion();
     }
 
     return TRUE;
@@ -205,6 +228,7 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
     case IDC_CH_RESAMPLE:
       imp->checked.Set(Checked::CH_RESAMPLE,
                        IsDlgButtonChecked(hWnd, IDC_CH_RESAMPLE) != 0);
+      imp->PrefetchMotion();
       break;
 
     case IDC_CH_ADDITIVE:
@@ -227,11 +251,28 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
                        IsDlgButtonChecked(hWnd, IDC_CH_DISABLEIK) != 0);
       break;
 
+    case IDC_CH_MULTITHREAD:
+      imp->checked.Set(Checked::CH_MULTITHREAD,
+                       IsDlgButtonChecked(hWnd, IDC_CH_MULTITHREAD) != 0);
+      break;
+
+    case IDC_CH_REDUCEKEYS:
+      imp->checked.Set(Checked::CH_REDUCEKEYS,
+                       IsDlgButtonChecked(hWnd, IDC_CH_REDUCEKEYS) != 0);
+      break;
+
+    case IDC_CH_NATIVEKEYS:
+      imp->checked.Set(Checked::CH_NATIVEKEYS,
+                       IsDlgButtonChecked(hWnd, IDC_CH_NATIVEKEYS) != 0);
+      imp->PrefetchMotion();
+      break;
+
     case IDC_RD_ANIALL:
       imp->checked += Checked::RD_ANIALL;
       imp->checked -= Checked::RD_ANISEL;
       imp->visible -= Visible::CB_MOTION;
       EnableWindow(imp->comboHandle, false);
+      imp->prefetch.Cancel();
       break;
 
     case IDC_RD_ANISEL:
@@ -239,6 +280,7 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
       imp->checked += Checked::RD_ANISEL;
       imp->visible += Visible::CB_MOTION;
       EnableWindow(imp->comboHandle, true);
+      imp->PrefetchMotion();
       break;
 
     case IDC_CB_MOTION: {
@@ -246,6 +288,7 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
       case CBN_SELCHANGE: {
         const LRESULT curSel = SendMessage((HWND)lParam, CB_GETCURSEL, 0, 0);
         imp->motionIndex = curSel;
+        imp->PrefetchMotion();
         return TRUE;
       } break;
       }
@@ -256,6 +299,7 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
       case CBN_SELCHANGE: {
         const LRESULT curSel = SendMessage((HWND)lParam, CB_GETCURSEL, 0, 0);
         imp->frameRateIndex = curSel;
+        imp->PrefetchMotion();
         return TRUE;
       } break;
       }
@@ -268,12 +312,177 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
     case IDC_SPIN_SCALE:
       imp->objectScale = reinterpret_cast<ISpinnerControl *>(lParam)->GetFVal();
       break;
+    case IDC_SPIN_POSTOL:
+      imp->positionTolerance =
+          reinterpret_cast<ISpinnerControl *>(lParam)->GetFVal();
+      break;
+    case IDC_SPIN_ROTTOL:
+      imp->rotationTolerance =
+          reinterpret_cast<ISpinnerControl *>(lParam)->GetFVal();
+      break;
+    case IDC_SPIN_SCLTOL:
+      imp->scaleTolerance =
+          reinterpret_cast<ISpinnerControl *>(lParam)->GetFVal();
+      break;
     }
   }
   return 0;
 }
 
-int RevilMax::SpawnDialog() {
-  return DialogBoxParam(hInstance, MAKEINTRESOURCE(IDD_REMOTION_IMPORT),
-                        GetActiveWindow(), DialogCallbacks, (LPARAM)this);
+void RevilMax::ApplyOptions(const BatchOptions &options,
+                            int32 motionIndex_) {
+  checked = es::Flags<Checked>(Checked::RD_ANIALL);
+
+  if (motionIndex_ >= 0) {
+    checked = es::Flags<Checked>(Checked::RD_ANISEL);
+    motionIndex = motionIndex_;
+  }
+
+  checked.Set(Checked::CH_RESAMPLE, options.resample);
+  checked.Set(Checked::CH_ADDITIVE, options.additive);
+  checked.Set(Checked::CH_DISABLEIK, options.disableIK);
+  checked.Set(Checked::CH_NOLOGBONES, !options.logBones);
+  checked.Set(Checked::CH_REDUCEKEYS, options.reduceKeys);
+  checked.Set(Checked::CH_NATIVEKEYS, options.nativeKeys);
+  checked += Checked::CH_MULTITHREAD;
+  objectScale = options.scale;
+  positionTolerance = options.tolerances.position;
+  rotationTolerance = options.tolerances.rotation;
+  scaleTolerance = options.tolerances.scale;
+  frameRateIndex = options.frameRate >= 60;
+  profileImport = options.profile;
+  profileTrace = false;
+}
+
+void RevilMax::ReportProfile() {
+  if (profileImport) {
+    es::print::Get() << profile.Summary();
+    es::print::FlushAll();
+  }
+
+  if (profileTrace) {
+    const TSTRING tracePath = GetTracePath();
+    std::ofstream str(tracePath.data());
+
+    if (str) {
+      profile.WriteTrace(str);
+      printline("Import trace saved into: " << std::to_string(tracePath));
+    } else {
+      printerror("Couldn't write import trace: " << std::to_string(tracePath));
+    }
+  }
+
+  profile.Reset();
+}
+
+revilmax::WorkerPool *RevilMax::GetPool() const {
+  return checked[Checked::CH_MULTITHREAD] ? &revilmax::WorkerPool::Get()
+                                          : nullptr;
+}
+
+revilmax::ReduceTolerances RevilMax::GetTolerances() const {
+  revilmax::ReduceTolerances tolerances;
+  tolerances.position = positionTolerance;
+  tolerances.rotation = rotationTolerance;
+  tolerances.scale = scaleTolerance;
+
+  return tolerances;
+}
+
+revilmax::AssetCache &RevilMax::GetCache() const {
+  revilmax::AssetCache &cache = revilmax::AssetCache::Get();
+  cache.Budget(size_t(cacheBudget) << 20);
+  return cache;
+}
+
+int32 RevilMax::SampleTicksPerFrame(const uni::Motion &mot) const {
+  return SampleTicksPerFrame(mot, GetTicksPerFrame());
+}
+
+int32 RevilMax::SampleTicksPerFrame(const uni::Motion &mot,
+                                    int32 sceneTicksPerFrame) const {
+  const uint32 frameRate = mot.FrameRate();
+
+  if (!checked[Checked::CH_NATIVEKEYS] || !frameRate) {
+    return sceneTicksPerFrame;
+  }
+
+  return revilmax::TICKS_PER_SEC / frameRate;
+}
+
+revilmax::MotionSamples
+RevilMax::SampleMotion(const uni::Motion &mot,
+                       const revilmax::FrameGrid &grid) {
+  revilmax::ScopedPhase phase(profile, "sampling");
+  revilmax::WorkerPool *pool = GetPool();
+  revilmax::MotionSamples samples;
+
+  if (!checked[Checked::RD_ANISEL] ||
+      !prefetch.Take(motionIndex, grid, samples)) {
+    samples = revilmax::SampleMotion(mot, grid, pool);
+  }
+
+  revilmax::PrepareSamples(samples, objectScale);
+
+  if (checked[Checked::CH_REDUCEKEYS]) {
+    revilmax::ReduceSamples(samples, GetTolerances(), pool);
+  } else if (checked[Checked::CH_NATIVEKEYS]) {
+    revilmax::ReduceSamples(samples, revilmax::ReduceTolerances::Lossless(),
+                            pool);
+  }
+
+  return samples;
+}
+
+void RevilMax::BakeMotions(std::vector<MotionBake> &bakes) {
+  auto bakeOne = [&](size_t index) { BakeMotion(bakes[index]); };
+  revilmax::WorkerPool *pool = GetPool();
+
+  if (pool) {
+    pool->ParallelFor(bakes.size(), bakeOne);
+  } else {
+    for (size_t i = 0; i < bakes.size(); i++) {
+      bakeOne(i);
+    }
+  }
+}
+
+void RevilMax::PrefetchMotion() {
+  prefetch.Cancel();
+
+  if (!dialogMotions || !checked[Checked::RD_ANISEL] ||
+      motionIndex >= dialogMotions->Size()) {
+    return;
+  }
+
+  auto mot = dialogMotions->At(motionIndex);
+  revilmax::FrameGrid grid;
+
+  if (!mot || !PrefetchGrid(*mot, grid)) {
+    return;
+  }
+
+  prefetch.Start(motionIndex, std::move(mot), dialogAsset, std::move(grid),
+                 GetPool());
+}
+
+int RevilMax::SpawnDialog(const uni::List<uni::Motion> *motions,
+                          std::shared_ptr<void> asset) {
+  dialogMotions = motions;
+  dialogAsset = std::move(asset);
+  const int result =
+      DialogBoxParam(hInstance, MAKEINTRESOURCE(IDD_REMOTION_IMPORT),
+                     GetActiveWindow(), DialogCallbacks, (LPARAM)this);
+  // Prefetch keeps its own reference to asset
+  dialogMotions = nullptr;
+  dialogAsset.reset();
+
+  if (result) {
+    // Importer might touch motion right away
+    prefetch.Wait();
+  } else {
+    prefetch.Cancel();
+  }
+
+  return result;
 }
@@ -30,11 +30,16 @@
 #include <impexp.h>
 #undef min
 #undef max
-#include "datas/flags.hpp"
-#include "datas/reflector.hpp"
 #include "datas/tchar.hpp"
+#include "AssetCache.h"
+#include "ImportFlags.h"
+#include "ImportProfile.h"
+#include "KeyCommit.h"
+#include "KeyReducer.h"
+#include "MotionPrefetch.h"
 #include "project.h"
 
+#include <memory>
 #include <vector>
 
 extern HINSTANCE hInstance;
@@ -42,18 +47,42 @@ extern HINSTANCE hInstance;
 static constexpr int REVILMAX_VERSIONINT =
     RevilMax_VERSION_MAJOR * 100 + RevilMax_VERSION_MINOR;
 
-static const Matrix3 corMat = {{1.0f, 0.0f, 0.0f},
-                               {0.0f, 0.0f, 1.0f},
-                               {0.0f, -1.0f, 0.0f},
-                               {0.0f, 0.0f, 0.0f}};
-
-MAKE_ENUM(ENUMSCOPE(class Checked
-                    : uint8, Checked),
-          EMEMBER(RD_ANIALL), EMEMBER(RD_ANISEL), EMEMBER(CH_RESAMPLE),
-          EMEMBER(CH_ADDITIVE), EMEMBER(CH_DISABLEIK), EMEMBER(CH_NO_CACHE),
-          EMEMBER(CH_NOLOGBONES));
+// Explicit import settings for scripted imports, dialog config is not used
+struct BatchOptions {
+  // Motions imported from every file in given order, each as a separate
+  // import. All motions at once if empty.
+  std::vector<int32> motionIndices;
+  float scale = 1.0f;
+  // MTF only, 30 or 60
+  int32 frameRate = 60;
+  bool resample = false;
+  bool additive = false;
+  bool disableIK = false;
+  // Report tracks of bones missing in scene
+  bool logBones = true;
+  bool reduceKeys = false;
+  bool nativeKeys = false;
+  // Used by key reduction, RE rotations are always reduced
+  revilmax::ReduceTolerances tolerances;
+  // Lay files out one after another instead of replacing previous animation
+  bool append = true;
+  // Print import profile of every file
+  bool profile = false;
+};
 
-MAKE_ENUM(ENUMSCOPE(class Visible : uint8, Visible), EMEMBER(CB_MOTION));
+// Motion placed on timeline, sampled ahead of key commit
+struct MotionBake {
+  const uni::Motion *motion = nullptr;
+  // Scene frames, defines animation range
+  revilmax::FrameGrid sceneGrid;
+  // Frames motion is sampled at
+  revilmax::FrameGrid grid;
+  revilmax::MotionSamples samples;
+
+  Interval Range() const {
+    return Interval(sceneGrid.start, sceneGrid.RangeEnd());
+  }
+};
 
 class RevilMax {
 public:
@@ -62,18 +91,76 @@ public:
   es::Flags<Checked> checked;
   es::Flags<Visible> visible;
   float objectScale;
+  float positionTolerance, rotationTolerance, scaleTolerance;
   uint32 motionIndex, frameRateIndex;
+  // Asset cache budget in MB
+  uint32 cacheBudget;
+  // Print phase timings and counters after import
+  bool profileImport;
+  // Write Chrome trace of import into plugin config directory
+  bool profileTrace;
 
   DLGTYPE_e instanceDialogType;
+  KeyCommitMode keyCommitMode = KeyCommitMode::KeyControl;
   HWND comboHandle;
   HWND hWnd;
   std::vector<TSTRING> motionNames;
+  // Motion list behind motionNames, selected motion is sampled while dialog
+  // is open. Only set by SpawnDialog.
+  const uni::List<uni::Motion> *dialogMotions = nullptr;
+  // Cached asset holding dialogMotions
+  std::shared_ptr<void> dialogAsset;
+  // Holds selected motion and its asset until import is done
+  revilmax::MotionPrefetch prefetch;
   int windowSize, button1Distance, button2Distance;
+  // Timeline position of first imported motion
+  TimeValue importStart = 0;
+  // Keep animation of previous imports
+  bool keepScene = false;
+  // Timeline ranges of all motions loaded by DoImport
+  std::vector<Interval> importedRanges;
+  revilmax::ImportProfile profile;
+
+  virtual void DoImport(const std::string &fileName, bool suppressPrompts) = 0;
+  // Decodes file into asset cache, returned handle keeps it alive
+  virtual std::shared_ptr<void> FetchAsset(const std::string &fileName) = 0;
+  // Imports motion at motionIndex, all motions if negative
+  void ApplyOptions(const BatchOptions &options, int32 motionIndex);
+  // Reports profile according to settings and starts a new one
+  void ReportProfile();
 
   void LoadCFG();
   void BuildCFG();
   void SaveCFG();
-  int SpawnDialog();
+  // Motions are listed in dialog, asset holds them
+  int SpawnDialog(const uni::List<uni::Motion> *motions,
+                  std::shared_ptr<void> asset);
+
+  revilmax::WorkerPool *GetPool() const;
+  revilmax::ReduceTolerances GetTolerances() const;
+  revilmax::AssetCache &GetCache() const;
+  // Scene frame spacing or motion's own frame spacing for source keys mode
+  int32 SampleTicksPerFrame(const uni::Motion &mot) const;
+  int32 SampleTicksPerFrame(const uni::Motion &mot,
+                            int32 sceneTicksPerFrame) const;
+  // Samples, prepares and reduces motion according to settings.
+  // Uses prefetched samples of selected motion when they match grid.
+  revilmax::MotionSamples SampleMotion(const uni::Motion &mot,
+                                       const revilmax::FrameGrid &grid);
+  // Samples motion into bake.samples
+  virtual void BakeMotion(MotionBake &bake) {
+    bake.samples = SampleMotion(*bake.motion, bake.grid);
+  }
+  // Bakes every motion concurrently into its own buffers, one motion per job.
+  // Must not touch the scene.
+  void BakeMotions(std::vector<MotionBake> &bakes);
+  // Restarts background sampling of selected motion
+  void PrefetchMotion();
+  // Frame grid motion will be sampled at once dialog settings are applied,
+  // false if motion can't be prefetched
+  virtual bool PrefetchGrid(const uni::Motion &, revilmax::FrameGrid &) {
+    return false;
+  }
 
   RevilMax();
   virtual ~RevilMax() {}
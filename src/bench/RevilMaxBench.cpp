@@ -0,0 +1,625 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+// Decoding and sampling throughput of MTF and RE Engine motion files,
+// runs without 3ds Max.
+// Usage: revilmax-bench [-i iterations] [-f fps] [-j threads]
+//                        [-s bonesxframes]... [-t prs] [-m constant,sparse]
+//                        [-r seed] [-g dumpdir] [-c goldendir]
+//                        [-a degrees] [-k] [path]...
+// Paths can be files or directories, directories are scanned recursively.
+// -f is frame rate of LMT and generated motions, RE motions are sampled at
+// their own frame rate like RE import does without resampling.
+// Each -s adds a generated motion, -t selects track types, -m the share of
+// constant and sparse tracks and -r the seed of all generated motions,
+// see SyntheticSpec.
+// RE Engine files with skeletons are also imported into MemoryScene,
+// -g writes key dump of every such file into dumpdir for golden comparison,
+// -c compares them with dumps of the same name in goldendir. Goldens only
+// match when written with the same -f and -a.
+// Rotation keys are selected within -a angular error like RE import does,
+// -k lists kept rotation keys of every track on stderr.
+// Results are written to stdout as one JSON object per line for every format
+// version found, progress and errors go to stderr.
+// Exits with 2 if any file failed to load, 3 if any dump differs from its
+// golden, 4 if import option flags don't survive a round trip.
+
+#include "ImportFlags.h"
+#include "KeyReducer.h"
+#include "MappedFile.h"
+#include "MemoryScene.h"
+#include "MotionSampler.h"
+#include "SceneCommit.h"
+#include "SyntheticMotion.h"
+#include "WorkerPool.h"
+#include "datas/binreader_stream.hpp"
+#include "revil/lmt.hpp"
+#include "revil/re_asset.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  size_t iterations = 5;
+  uint32 frameRate = 60;
+  // 0 uses all cores, 1 samples serially
+  size_t numThreads = 0;
+  // Key dumps of scene imports are written here if not empty
+  fs::path dumpDir;
+  // Key dumps are compared with goldens here if not empty
+  fs::path goldenDir;
+  // Degrees
+  float rotationTolerance = 0.1f;
+  bool listKeys = false;
+};
+
+struct FormatResult {
+  size_t files = 0;
+  size_t bytes = 0;
+  size_t motions = 0;
+  size_t tracks = 0;
+  size_t samples = 0;
+  size_t keys = 0;
+  size_t rotationFrames = 0;
+  size_t rotationKeys = 0;
+  double decodeSecs = 0;
+  double sampleSecs = 0;
+  double reduceSecs = 0;
+  double sceneSecs = 0;
+};
+
+enum class FileKind { Unknown, LMT, RE };
+
+struct DecodedFile {
+  // Owns motions
+  std::shared_ptr<void> asset;
+  uni::MotionsConst list;
+  std::vector<uni::Element<const uni::Motion>> motions;
+  uni::SkeletonsConst skeletons;
+};
+
+static double Seconds(Clock::time_point begin) {
+  return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+static std::string ToLower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+// RE Engine files carry format version in extension: name.mot.65
+static FileKind ClassifyFile(const fs::path &path, std::string &extension) {
+  const std::string fileName = ToLower(path.filename().string());
+  const size_t dot = fileName.find('.');
+
+  if (dot == std::string::npos) {
+    return FileKind::Unknown;
+  }
+
+  extension = fileName.substr(dot + 1);
+  static const char *mtfExtensions[]{"lmt", "tml", "mlx", "mtx", "mti"};
+
+  for (auto e : mtfExtensions) {
+    if (extension == e) {
+      return FileKind::LMT;
+    }
+  }
+
+  if (!extension.compare(0, 3, "mot")) {
+    return FileKind::RE;
+  }
+
+  return FileKind::Unknown;
+}
+
+// LMT version and byte order are read from header: "LMT\0" then version
+static std::string LMTFormat(const revilmax::MappedFile &file) {
+  if (file.Size() < 6) {
+    return "lmt";
+  }
+
+  const auto *data = reinterpret_cast<const uint8 *>(file.Data());
+  const bool bigEndian = !memcmp(data, "\0TML", 4);
+  const uint16 version =
+      bigEndian ? (data[4] << 8) | data[5] : data[4] | (data[5] << 8);
+
+  return "lmt." + std::to_string(version) + (bigEndian ? ".be" : "");
+}
+
+template <class AssetType>
+static DecodedFile Decode(const revilmax::MappedFile &file) {
+  revilmax::MappedStream stream(file);
+  BinReaderRef rd(stream);
+  auto asset = std::make_shared<AssetType>();
+  asset->Load(rd);
+  DecodedFile decoded;
+  decoded.asset = asset;
+
+  auto addMotions = [&](uni::MotionsConst motions) {
+    if (!motions) {
+      return;
+    }
+
+    for (size_t m = 0; m < motions->Size(); m++) {
+      if (auto mot = motions->At(m)) {
+        decoded.motions.emplace_back(std::move(mot));
+      }
+    }
+
+    decoded.list = std::move(motions);
+  };
+
+  if constexpr (std::is_same_v<AssetType, revil::LMT>) {
+    addMotions(*asset);
+  } else {
+    if (auto motions = asset->template As<uni::MotionsConst>()) {
+      addMotions(std::move(motions));
+    } else if (auto mot =
+                   asset->template As<uni::Element<const uni::Motion>>()) {
+      decoded.motions.emplace_back(std::move(mot));
+    }
+
+    decoded.skeletons = asset->template As<uni::SkeletonsConst>();
+  }
+
+  return decoded;
+}
+
+// Same frame step as importers without resampling: motion's own frame rate,
+// -f for LMT motions and motions without one
+static int32 GridTicksPerFrame(const uni::Motion &mot,
+                               const BenchOptions &options) {
+  const uint32 frameRate = mot.FrameRate();
+  return revilmax::TICKS_PER_SEC / (frameRate ? frameRate : options.frameRate);
+}
+
+// Same grids as importers, RE motions include end frame
+static void BenchSampling(const uni::Motion &mot, bool includeEndFrame,
+                          const BenchOptions &options,
+                          revilmax::WorkerPool *pool, FormatResult &result) {
+  const revilmax::FrameGrid grid = revilmax::BuildFrameGrid(
+      mot.Duration(), GridTicksPerFrame(mot, options), 0, includeEndFrame);
+  const Clock::time_point sampleBegin = Clock::now();
+  revilmax::MotionSamples samples;
+
+  for (size_t i = 0; i < options.iterations; i++) {
+    samples = revilmax::SampleMotion(mot, grid, pool);
+  }
+
+  result.sampleSecs += Seconds(sampleBegin);
+  revilmax::PrepareSamples(samples, 1.f);
+  const Clock::time_point reduceBegin = Clock::now();
+
+  for (size_t i = 0; i < options.iterations; i++) {
+    revilmax::ReduceRotations(samples, options.rotationTolerance, pool);
+  }
+
+  result.reduceSecs += Seconds(reduceBegin);
+
+  for (auto &t : samples) {
+    if (t.trackType != uni::MotionTrack::Rotation) {
+      continue;
+    }
+
+    result.rotationFrames += t.values.size();
+    result.rotationKeys += t.NumKeys();
+
+    if (options.listKeys) {
+      fprintf(stderr, "%s bone %zu: %zu of %zu rotation keys\n",
+              mot.Name().c_str(), t.boneIndex, t.NumKeys(), t.values.size());
+    }
+  }
+
+  result.motions++;
+  result.tracks += samples.size();
+  result.samples += samples.size() * grid.NumFrames();
+}
+
+// Load all path of REEngineImport with default settings, MemoryScene takes
+// place of 3ds Max. Samples are prepared ahead, only scene work is timed.
+// Key dump of final scene is written into dump, if provided.
+static void BenchScene(const DecodedFile &decoded, const BenchOptions &options,
+                       revilmax::WorkerPool *pool, FormatResult &result,
+                       std::string *dump) {
+  const size_t numSkeletons =
+      decoded.skeletons ? decoded.skeletons->Size() : 0;
+
+  if (!numSkeletons || decoded.motions.empty()) {
+    return;
+  }
+
+  const size_t numMotions = decoded.motions.size();
+  std::vector<uni::Element<const uni::Skeleton>> skeletons;
+  std::vector<revilmax::FrameGrid> grids;
+  std::vector<revilmax::MotionSamples> samples;
+  int32 lastTime = 0;
+
+  for (size_t m = 0; m < numMotions; m++) {
+    const uni::Motion &mot = *decoded.motions[m];
+    skeletons.emplace_back(decoded.skeletons->At(
+        numMotions > numSkeletons ? 0 : m));
+    grids.emplace_back(revilmax::BuildFrameGrid(
+        mot.Duration(), GridTicksPerFrame(mot, options), lastTime, true));
+    lastTime = grids.back().NextStart();
+    samples.emplace_back(revilmax::SampleMotion(mot, grids.back(), pool));
+    revilmax::PrepareSamples(samples.back(), 1.f);
+    revilmax::ReduceRotations(samples.back(), options.rotationTolerance,
+                              pool);
+  }
+
+  revilmax::MemoryScene scene;
+  const revilmax::SkeletonImportSettings settings;
+  const Clock::time_point sceneBegin = Clock::now();
+
+  for (size_t i = 0; i < options.iterations; i++) {
+    scene.Clear();
+    revilmax::BoneNodes nodes;
+    revilmax::ScenePose pose;
+    std::vector<revilmax::SceneBackend::Node> bones;
+
+    for (size_t m = 0; m < numMotions; m++) {
+      const revilmax::FrameGrid &grid = grids[m];
+
+      if (skeletons[m]) {
+        revilmax::ImportSkeleton(scene, *skeletons[m], grid.start, settings,
+                                 nodes);
+      }
+
+      // Every node is a tagged bone
+      bones.resize(scene.Nodes().size());
+
+      for (size_t n = 0; n < bones.size(); n++) {
+        bones[n] = static_cast<revilmax::SceneBackend::Node>(n);
+      }
+
+      pose.Build(scene, bones);
+      revilmax::CommitSamples(scene, samples[m], grid, nodes, &pose);
+      pose.KeyEndPose(grid.NextStart() - grid.ticksPerFrame);
+    }
+  }
+
+  result.sceneSecs += Seconds(sceneBegin);
+  result.keys += scene.NumKeys();
+
+  if (dump) {
+    std::ostringstream str;
+    scene.Dump(str);
+    *dump = str.str();
+  }
+}
+
+// Reports first differing line, missing golden is a mismatch too
+static bool MatchesGolden(const fs::path &goldenPath,
+                          const std::string &dump) {
+  std::ifstream golden(goldenPath);
+
+  if (!golden) {
+    fprintf(stderr, "%s: golden not found\n", goldenPath.string().c_str());
+    return false;
+  }
+
+  std::istringstream current(dump);
+  std::string expected;
+  std::string actual;
+
+  for (size_t line = 1;; line++) {
+    const bool hasExpected = !!std::getline(golden, expected);
+    const bool hasActual = !!std::getline(current, actual);
+
+    if (!hasExpected && !hasActual) {
+      return true;
+    }
+
+    if (hasExpected != hasActual || expected != actual) {
+      fprintf(stderr, "%s:%zu: expected \"%s\", got \"%s\"\n",
+              goldenPath.string().c_str(), line,
+              hasExpected ? expected.c_str() : "<end>",
+              hasActual ? actual.c_str() : "<end>");
+      return false;
+    }
+  }
+}
+
+// Returns false if key dump differs from golden
+static bool BenchFile(const fs::path &path, FileKind kind,
+                      const BenchOptions &options,
+                      revilmax::WorkerPool *pool, FormatResult &result) {
+  revilmax::MappedFile file(path.string());
+  DecodedFile decoded;
+  const Clock::time_point decodeBegin = Clock::now();
+
+  for (size_t i = 0; i < options.iterations; i++) {
+    decoded = kind == FileKind::LMT ? Decode<revil::LMT>(file)
+                                    : Decode<revil::REAsset>(file);
+  }
+
+  result.decodeSecs += Seconds(decodeBegin);
+
+  for (auto &mot : decoded.motions) {
+    if (kind == FileKind::LMT) {
+      mot->FrameRate(options.frameRate);
+    }
+
+    BenchSampling(*mot, kind == FileKind::RE, options, pool, result);
+  }
+
+  bool matches = true;
+
+  if (kind == FileKind::RE) {
+    const std::string dumpName = path.filename().string() + ".keys";
+    const bool needsDump =
+        !options.dumpDir.empty() || !options.goldenDir.empty();
+    std::string dump;
+    BenchScene(decoded, options, pool, result, needsDump ? &dump : nullptr);
+
+    if (!dump.empty() && !options.dumpDir.empty()) {
+      std::ofstream str(options.dumpDir / dumpName);
+      str << dump;
+    }
+
+    if (!dump.empty() && !options.goldenDir.empty()) {
+      matches = MatchesGolden(options.goldenDir / dumpName, dump);
+    }
+  }
+
+  result.files++;
+  result.bytes += file.Size();
+
+  return matches;
+}
+
+// Generation takes place of decoding
+static void BenchSynthetic(const revilmax::SyntheticSpec &spec,
+                           const BenchOptions &options,
+                           revilmax::WorkerPool *pool, FormatResult &result) {
+  std::unique_ptr<revilmax::SyntheticMotion> mot;
+  const Clock::time_point generateBegin = Clock::now();
+
+  for (size_t i = 0; i < options.iterations; i++) {
+    mot = std::make_unique<revilmax::SyntheticMotion>(spec);
+  }
+
+  result.decodeSecs += Seconds(generateBegin);
+  BenchSampling(*mot, false, options, pool, result);
+  result.files++;
+}
+
+static std::string FormatOf(const fs::path &path, FileKind kind,
+                            const std::string &extension) {
+  if (kind == FileKind::RE) {
+    return extension;
+  }
+
+  revilmax::MappedFile file(path.string());
+  return LMTFormat(file);
+}
+
+static void PrintResult(const std::string &format, const FormatResult &r,
+                        const BenchOptions &options, size_t numThreads) {
+  const double iterations = static_cast<double>(options.iterations);
+  auto perSec = [](double value, double secs) {
+    return secs > 0 ? value / secs : 0;
+  };
+
+  printf("{\"format\":\"%s\",\"files\":%zu,\"motions\":%zu,\"tracks\":%zu,"
+         "\"samples\":%zu,\"bytes\":%zu,\"iterations\":%zu,\"frameRate\":%u,"
+         "\"threads\":%zu,\"decodeSeconds\":%.6f,\"sampleSeconds\":%.6f,"
+         "\"reduceSeconds\":%.6f,\"rotationFrames\":%zu,"
+         "\"rotationKeys\":%zu,\"sceneSeconds\":%.6f,\"keys\":%zu,"
+         "\"decodeTracksPerSec\":%.1f,\"decodeBytesPerSec\":%.1f,"
+         "\"sampleTracksPerSec\":%.1f,\"samplesPerSec\":%.1f,"
+         "\"sceneKeysPerSec\":%.1f}\n",
+         format.c_str(), r.files, r.motions, r.tracks, r.samples, r.bytes,
+         options.iterations, options.frameRate, numThreads, r.decodeSecs,
+         r.sampleSecs, r.reduceSecs, r.rotationFrames, r.rotationKeys,
+         r.sceneSecs, r.keys,
+         perSec(r.tracks * iterations, r.decodeSecs),
+         perSec(r.bytes * iterations, r.decodeSecs),
+         perSec(r.tracks * iterations, r.sampleSecs),
+         perSec(r.samples * iterations, r.sampleSecs),
+         perSec(r.keys * iterations, r.sceneSecs));
+}
+
+// Every import option must read back after Set, flags are stored in
+// underlying type of Checked
+static bool CheckImportFlags() {
+  const size_t numFlags = static_cast<size_t>(Checked::CH_NATIVEKEYS) + 1;
+  bool valid = true;
+
+  for (size_t f = 0; f < numFlags; f++) {
+    const Checked flag = static_cast<Checked>(f);
+    es::Flags<Checked> flags;
+    flags.Set(flag, true);
+    const bool isSet = flags[flag];
+    flags.Set(flag, false);
+
+    if (!isSet || flags[flag]) {
+      fprintf(stderr, "Import option flag %zu is lost by es::Flags\n", f);
+      valid = false;
+    }
+  }
+
+  return valid;
+}
+
+static void PrintUsage() {
+  fprintf(stderr, "Usage: revilmax-bench [-i iterations] [-f fps] "
+                  "[-j threads] [-s bonesxframes]... [-t prs] "
+                  "[-m constant,sparse] [-r seed] [-g dumpdir] "
+                  "[-c goldendir] [-a degrees] [-k] "
+                  "[file or directory]...\n");
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions options;
+  std::vector<fs::path> paths;
+  // Bone and frame count of generated motions
+  std::vector<std::pair<size_t, size_t>> synthetic;
+  revilmax::SyntheticSpec spec;
+
+  for (int a = 1; a < argc; a++) {
+    const std::string arg = argv[a];
+    const bool hasValue = a + 1 < argc;
+
+    if (arg == "-i" && hasValue) {
+      options.iterations = std::max(1, atoi(argv[++a]));
+    } else if (arg == "-f" && hasValue) {
+      options.frameRate = std::max(1, atoi(argv[++a]));
+    } else if (arg == "-j" && hasValue) {
+      options.numThreads = std::max(0, atoi(argv[++a]));
+    } else if (arg == "-s" && hasValue) {
+      unsigned long numBones = 0;
+      unsigned long numFrames = 0;
+
+      if (sscanf(argv[++a], "%lux%lu", &numBones, &numFrames) != 2) {
+        PrintUsage();
+        return 1;
+      }
+
+      synthetic.emplace_back(numBones, numFrames);
+    } else if (arg == "-t" && hasValue) {
+      const std::string types = argv[++a];
+      spec.position = types.find('p') != std::string::npos;
+      spec.rotation = types.find('r') != std::string::npos;
+      spec.scale = types.find('s') != std::string::npos;
+    } else if (arg == "-m" && hasValue) {
+      if (sscanf(argv[++a], "%f,%f", &spec.constantRatio,
+                 &spec.sparseRatio) != 2) {
+        PrintUsage();
+        return 1;
+      }
+    } else if (arg == "-r" && hasValue) {
+      spec.seed = static_cast<uint32>(strtoul(argv[++a], nullptr, 10));
+    } else if (arg == "-g" && hasValue) {
+      options.dumpDir = argv[++a];
+    } else if (arg == "-c" && hasValue) {
+      options.goldenDir = argv[++a];
+    } else if (arg == "-a" && hasValue) {
+      options.rotationTolerance = std::max(0.f, strtof(argv[++a], nullptr));
+    } else if (arg == "-k") {
+      options.listKeys = true;
+    } else if (arg[0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+
+  if (paths.empty() && synthetic.empty()) {
+    PrintUsage();
+    return 1;
+  }
+
+  if (!CheckImportFlags()) {
+    return 4;
+  }
+
+  std::vector<fs::path> files;
+
+  for (auto &p : paths) {
+    if (fs::is_directory(p)) {
+      for (auto &e : fs::recursive_directory_iterator(p)) {
+        if (e.is_regular_file()) {
+          files.push_back(e.path());
+        }
+      }
+    } else {
+      files.push_back(p);
+    }
+  }
+
+  std::sort(files.begin(), files.end());
+
+  if (!options.dumpDir.empty()) {
+    fs::create_directories(options.dumpDir);
+  }
+
+  std::unique_ptr<revilmax::WorkerPool> pool;
+
+  if (options.numThreads != 1) {
+    // Calling thread is a worker too
+    pool = std::make_unique<revilmax::WorkerPool>(
+        options.numThreads ? options.numThreads - 1 : 0);
+  }
+
+  const size_t numThreads = pool ? pool->NumWorkers() + 1 : 1;
+  std::map<std::string, FormatResult> results;
+  int numFailed = 0;
+  int numMismatched = 0;
+
+  for (auto &f : files) {
+    std::string extension;
+    const FileKind kind = ClassifyFile(f, extension);
+
+    if (kind == FileKind::Unknown) {
+      continue;
+    }
+
+    try {
+      const std::string format = FormatOf(f, kind, extension);
+      if (!BenchFile(f, kind, options, pool.get(), results[format])) {
+        numMismatched++;
+      }
+      fprintf(stderr, "%s: %s\n", format.c_str(), f.string().c_str());
+    } catch (const std::exception &e) {
+      fprintf(stderr, "%s: %s\n", f.string().c_str(), e.what());
+      numFailed++;
+    } catch (...) {
+      fprintf(stderr, "%s: Unhandled exception has been thrown!\n",
+              f.string().c_str());
+      numFailed++;
+    }
+  }
+
+  spec.frameRate = options.frameRate;
+
+  for (auto &s : synthetic) {
+    spec.numBones = s.first;
+    spec.numFrames = s.second;
+    const std::string format = "synthetic." + std::to_string(s.first) + "x" +
+                               std::to_string(s.second);
+    BenchSynthetic(spec, options, pool.get(), results[format]);
+    fprintf(stderr, "%s\n", format.c_str());
+  }
+
+  for (auto &r : results) {
+    PrintResult(r.first, r.second, options, numThreads);
+  }
+
+  if (numMismatched) {
+    fprintf(stderr, "%d key dumps differ from golden\n", numMismatched);
+  }
+
+  return numFailed ? 2 : numMismatched ? 3 : 0;
+}
@@ -0,0 +1,225 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "SyntheticMotion.h"
+#include <cmath>
+
+namespace revilmax {
+// xorshift32, distribution free so sequences don't depend on standard library
+class SyntheticRandom {
+public:
+  explicit SyntheticRandom(uint32 seed) : state(seed ? seed : 0x9E3779B9) {}
+
+  uint32 Next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // [0, 1)
+  float Unit() { return (Next() >> 8) * (1.f / 16777216.f); }
+  // [-range, range)
+  float Signed(float range) { return (Unit() * 2.f - 1.f) * range; }
+
+private:
+  uint32 state;
+};
+
+// Smooth periodic curve, one per component
+struct SyntheticWave {
+  float amplitude;
+  float frequency;
+  float phase;
+
+  SyntheticWave(SyntheticRandom &rnd, float maxAmplitude)
+      : amplitude(rnd.Unit() * maxAmplitude),
+        frequency(0.25f + rnd.Unit() * 2.f),
+        phase(rnd.Unit() * 6.2831853f) {}
+
+  float operator()(float time) const {
+    return amplitude * std::sin(time * frequency * 6.2831853f + phase);
+  }
+};
+
+static Vector4A16 MakeKey(uni::MotionTrack::TrackType_e type,
+                          const SyntheticWave *waves, float time) {
+  switch (type) {
+  case uni::MotionTrack::Rotation: {
+    // Axis angle to quaternion
+    Vector4A16 axis(waves[0](time) + 0.01f, waves[1](time), waves[2](time),
+                    0.f);
+    axis.Normalize();
+    const float halfAngle = waves[3](time) * 0.5f;
+    Vector4A16 quat = axis * std::sin(halfAngle);
+    quat.W = std::cos(halfAngle);
+    return quat;
+  }
+  case uni::MotionTrack::Scale:
+    return Vector4A16(1.f + waves[0](time), 1.f + waves[1](time),
+                      1.f + waves[2](time), 0.f);
+  default:
+    return Vector4A16(waves[0](time), waves[1](time), waves[2](time), 1.f);
+  }
+}
+
+SyntheticTrack::SyntheticTrack(TrackType_e type_, size_t bone_,
+                               float keyDuration_,
+                               std::vector<Vector4A16> keys_)
+    : type(type_), bone(bone_), keyDuration(keyDuration_),
+      keys(std::move(keys_)) {}
+
+void SyntheticTrack::GetValue(Vector4A16 &output, float time) const {
+  const float keyTime = keyDuration > 0.f ? time / keyDuration : 0.f;
+  const size_t lastKey = keys.size() - 1;
+
+  if (keyTime <= 0.f || !lastKey) {
+    output = keys.front();
+    return;
+  }
+
+  const size_t key = static_cast<size_t>(keyTime);
+
+  if (key >= lastKey) {
+    output = keys.back();
+    return;
+  }
+
+  const float blend = keyTime - static_cast<float>(key);
+  output = keys[key] + (keys[key + 1] - keys[key]) * blend;
+
+  if (type == Rotation) {
+    output.Normalize();
+  }
+}
+
+void SyntheticTrack::GetValue(uni::RTSValue &output, float time) const {
+  Vector4A16 value;
+  GetValue(value, time);
+
+  switch (type) {
+  case Rotation:
+    output.rotation = value;
+    break;
+  case Scale:
+    output.scale = value;
+    break;
+  default:
+    output.translation = value;
+    break;
+  }
+}
+
+void SyntheticTrack::GetValue(esMatrix44 &output, float time) const {
+  Vector4A16 value;
+  GetValue(value, time);
+
+  switch (type) {
+  case Rotation:
+    output = esMatrix44(value);
+    break;
+  case Scale:
+    output = esMatrix44();
+    output.r1() *= value.X;
+    output.r2() *= value.Y;
+    output.r3() *= value.Z;
+    break;
+  default:
+    output = esMatrix44();
+    output.r4() = value;
+    break;
+  }
+}
+
+void SyntheticTrack::GetValue(float &output, float time) const {
+  Vector4A16 value;
+  GetValue(value, time);
+  output = value.X;
+}
+
+SyntheticMotion::SyntheticMotion(const SyntheticSpec &spec)
+    : name("synthetic_" + std::to_string(spec.numBones) + "x" +
+           std::to_string(spec.numFrames)),
+      frameRate(spec.frameRate),
+      duration(static_cast<float>(spec.numFrames) / spec.frameRate) {
+  SyntheticRandom rnd(spec.seed);
+  std::vector<uni::MotionTrack::TrackType_e> types;
+
+  if (spec.position) {
+    types.push_back(uni::MotionTrack::Position);
+  }
+
+  if (spec.rotation) {
+    types.push_back(uni::MotionTrack::Rotation);
+  }
+
+  if (spec.scale) {
+    types.push_back(uni::MotionTrack::Scale);
+  }
+
+  const float frameDuration = 1.f / spec.frameRate;
+  const size_t lastFrame = spec.numFrames ? spec.numFrames - 1 : 0;
+  const uint32 sparseStep = spec.sparseStep ? spec.sparseStep : 1;
+
+  for (size_t b = 0; b < spec.numBones; b++) {
+    for (auto type : types) {
+      const float layoutChance = rnd.Unit();
+      // Zero for single key
+      uint32 keyStep = 1;
+
+      if (layoutChance < spec.constantRatio) {
+        keyStep = 0;
+      } else if (layoutChance < spec.constantRatio + spec.sparseRatio) {
+        keyStep = sparseStep;
+      }
+
+      const float maxAmplitude =
+          type == uni::MotionTrack::Rotation ? 1.5f
+          : type == uni::MotionTrack::Scale  ? 0.2f
+                                             : 10.f;
+      const SyntheticWave waves[]{
+          {rnd, maxAmplitude},
+          {rnd, maxAmplitude},
+          {rnd, maxAmplitude},
+          {rnd, maxAmplitude},
+      };
+
+      const size_t numKeys =
+          keyStep ? (lastFrame + keyStep - 1) / keyStep + 1 : 1;
+      const float keyDuration = frameDuration * keyStep;
+      std::vector<Vector4A16> keys(numKeys);
+
+      for (size_t k = 0; k < numKeys; k++) {
+        keys[k] = MakeKey(type, waves, k * keyDuration);
+      }
+
+      tracks.emplace_back(std::make_unique<SyntheticTrack>(
+          type, b, keyDuration, std::move(keys)));
+    }
+  }
+}
+
+uni::MotionTracksConst SyntheticMotion::Tracks() const {
+  return uni::MotionTracksConst(this, false);
+}
+
+uni::Element<const uni::MotionTrack> SyntheticMotion::At(size_t id) const {
+  return uni::Element<const uni::MotionTrack>(tracks.at(id).get(), false);
+}
+} // namespace revilmax
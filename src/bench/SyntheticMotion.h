@@ -0,0 +1,93 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "datas/matrix44.hpp"
+#include "datas/vectors_simd.hpp"
+#include "uni/motion.hpp"
+#include "uni/rts.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Procedural motions for throughput runs without game assets.
+// They exist only in memory, no LMT or mot/motlist file is written, so
+// file loading and codec decoding are not exercised by them.
+// TODO: LMT and mot/motlist writers, they need round trip checks against
+// RevilLib readers before synthetic files can be trusted.
+namespace revilmax {
+struct SyntheticSpec {
+  size_t numBones = 5;
+  size_t numFrames = 60;
+  uint32 frameRate = 60;
+  bool position = true;
+  bool rotation = true;
+  bool scale = false;
+  // Share of single key tracks, like static codecs, and tracks with a key
+  // every sparseStep frames. Remaining tracks have a key every frame, like
+  // raw codecs.
+  float constantRatio = 0.2f;
+  float sparseRatio = 0.4f;
+  uint32 sparseStep = 8;
+  // Same seed and spec always produce same motion
+  uint32 seed = 1;
+};
+
+// Linearly interpolated keys, rotations are normalized after blending
+class SyntheticTrack : public uni::MotionTrack {
+public:
+  SyntheticTrack(TrackType_e type, size_t bone, float keyDuration,
+                 std::vector<Vector4A16> keys);
+
+  TrackType_e TrackType() const override { return type; }
+  size_t BoneIndex() const override { return bone; }
+  void GetValue(uni::RTSValue &output, float time) const override;
+  void GetValue(esMatrix44 &output, float time) const override;
+  void GetValue(Vector4A16 &output, float time) const override;
+  void GetValue(float &output, float time) const override;
+
+private:
+  TrackType_e type;
+  size_t bone;
+  // Time between two keys
+  float keyDuration;
+  std::vector<Vector4A16> keys;
+};
+
+class SyntheticMotion : public uni::Motion, public uni::List<uni::MotionTrack> {
+public:
+  explicit SyntheticMotion(const SyntheticSpec &spec);
+
+  std::string Name() const override { return name; }
+  void FrameRate(uint32 fps) const override { frameRate = fps; }
+  uint32 FrameRate() const override { return frameRate; }
+  float Duration() const override { return duration; }
+  uni::MotionTracksConst Tracks() const override;
+  MotionType_e MotionType() const override { return Relative; }
+
+  size_t Size() const override { return tracks.size(); }
+  uni::Element<const uni::MotionTrack> At(size_t id) const override;
+
+private:
+  std::string name;
+  mutable uint32 frameRate;
+  float duration;
+  std::vector<std::unique_ptr<SyntheticTrack>> tracks;
+};
+} // namespace revilmax
@@ -0,0 +1,160 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "AssetCache.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace revilmax {
+AssetCache &AssetCache::Get() {
+  static AssetCache cache;
+  return cache;
+}
+
+AssetCache::FileStamp AssetCache::GetFileStamp(const std::string &path) {
+  namespace fs = std::filesystem;
+  FileStamp stamp;
+  std::error_code ec;
+  // Paths are UTF-8, not ANSI code page
+  const fs::path fsPath = fs::u8path(path);
+  const auto size = fs::file_size(fsPath, ec);
+
+  if (!ec) {
+    stamp.size = size;
+  }
+
+  const auto modified = fs::last_write_time(fsPath, ec);
+
+  if (!ec) {
+    stamp.modified = modified.time_since_epoch().count();
+  }
+
+  return stamp;
+}
+
+AssetCache::AssetFuture
+AssetCache::Claim(const std::string &path, const FileStamp &stamp,
+                  std::type_index type,
+                  std::promise<std::shared_ptr<void>> &loaded) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto &l : loading) {
+    if (l.path == path && l.type == type) {
+      stats.hits++;
+      return l.asset;
+    }
+  }
+
+  if (auto found = Find(path, stamp, type)) {
+    std::promise<std::shared_ptr<void>> cached;
+    cached.set_value(std::move(found));
+    return cached.get_future().share();
+  }
+
+  loading.push_back(Loading{path, type, loaded.get_future().share()});
+
+  return {};
+}
+
+std::shared_ptr<void> AssetCache::Find(const std::string &path,
+                                       const FileStamp &stamp,
+                                       std::type_index type) {
+  for (auto it = entries.begin(); it != entries.end(); it++) {
+    if (it->path != path || it->type != type) {
+      continue;
+    }
+
+    if (it->stamp.size != stamp.size || it->stamp.modified != stamp.modified) {
+      // File changed on disk
+      stats.usedBytes -= it->stamp.size;
+      entries.erase(it);
+      stats.numEntries = entries.size();
+      break;
+    }
+
+    entries.splice(entries.begin(), entries, it);
+    stats.hits++;
+    return entries.front().asset;
+  }
+
+  stats.misses++;
+  return {};
+}
+
+void AssetCache::Insert(const std::string &path, const FileStamp &stamp,
+                        std::type_index type, std::shared_ptr<void> asset) {
+  std::lock_guard<std::mutex> lock(mutex);
+  loading.erase(std::remove_if(loading.begin(), loading.end(),
+                               [&](const Loading &l) {
+                                 return l.path == path && l.type == type;
+                               }),
+                loading.end());
+
+  if (!asset) {
+    return;
+  }
+
+  entries.push_front(Entry{path, stamp, type, std::move(asset)});
+  stats.usedBytes += stamp.size;
+  Evict();
+}
+
+void AssetCache::Evict() {
+  while (entries.size() > 1 && stats.usedBytes > budget) {
+    stats.usedBytes -= entries.back().stamp.size;
+    stats.evictions++;
+    entries.pop_back();
+  }
+
+  stats.numEntries = entries.size();
+}
+
+void AssetCache::Erase(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->path == path) {
+      stats.usedBytes -= it->stamp.size;
+      it = entries.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  stats.numEntries = entries.size();
+}
+
+void AssetCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  stats.usedBytes = 0;
+  stats.numEntries = 0;
+}
+
+void AssetCache::Budget(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  budget = bytes;
+  Evict();
+}
+
+AssetCache::Stats AssetCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+} // namespace revilmax
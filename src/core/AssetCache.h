@@ -0,0 +1,125 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+namespace revilmax {
+// Least recently used cache of decoded assets of any type.
+// Entries are keyed by path, file size and modification time, so edited
+// files are reloaded. Memory usage is estimated from file size.
+class AssetCache {
+public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t usedBytes = 0;
+    size_t numEntries = 0;
+  };
+
+  // Returns cached asset or creates it with loader(path).
+  // Returned asset stays valid after eviction.
+  // Concurrent fetches of the same file wait for the first loader, its
+  // exception is rethrown to all of them.
+  template <class T, class Loader>
+  std::shared_ptr<T> Fetch(const std::string &path, Loader &&loader) {
+    const FileStamp stamp = GetFileStamp(path);
+    std::promise<std::shared_ptr<void>> loaded;
+    AssetFuture found = Claim(path, stamp, typeid(T), loaded);
+
+    if (found.valid()) {
+      return std::static_pointer_cast<T>(found.get());
+    }
+
+    std::shared_ptr<T> asset;
+
+    try {
+      asset = loader(path);
+    } catch (...) {
+      Insert(path, stamp, typeid(T), nullptr);
+      loaded.set_exception(std::current_exception());
+      throw;
+    }
+
+    Insert(path, stamp, typeid(T), asset);
+    loaded.set_value(asset);
+    return asset;
+  }
+
+  void Erase(const std::string &path);
+  void Clear();
+  // Least recently used entries are evicted above budget,
+  // last loaded asset is always kept
+  void Budget(size_t bytes);
+  Stats GetStats() const;
+
+  static AssetCache &Get();
+
+private:
+  struct FileStamp {
+    uint64_t size = 0;
+    int64_t modified = 0;
+  };
+
+  using AssetFuture = std::shared_future<std::shared_ptr<void>>;
+
+  struct Entry {
+    std::string path;
+    FileStamp stamp;
+    std::type_index type;
+    std::shared_ptr<void> asset;
+  };
+
+  struct Loading {
+    std::string path;
+    std::type_index type;
+    AssetFuture asset;
+  };
+
+  // Front is most recently used
+  std::list<Entry> entries;
+  // Assets being loaded by Fetch
+  std::vector<Loading> loading;
+  size_t budget = size_t(512) << 20;
+  Stats stats;
+  mutable std::mutex mutex;
+
+  static FileStamp GetFileStamp(const std::string &path);
+  // Cached asset or asset being loaded by other thread. Otherwise returns
+  // invalid future and marks asset as loading, until Insert.
+  AssetFuture Claim(const std::string &path, const FileStamp &stamp,
+                    std::type_index type,
+                    std::promise<std::shared_ptr<void>> &loaded);
+  // Mutex must be held
+  std::shared_ptr<void> Find(const std::string &path, const FileStamp &stamp,
+                             std::type_index type);
+  // Ends loading, null asset is not cached
+  void Insert(const std::string &path, const FileStamp &stamp,
+              std::type_index type, std::shared_ptr<void> asset);
+  void Evict();
+};
+} // namespace revilmax
@@ -0,0 +1,44 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "BoneTransform.h"
+
+namespace revilmax {
+PoseMatrix ToPoseMatrix(const BoneTransform &tm) {
+  const Vector4A16 &q = tm.rotation;
+  const float xx = q.X * q.X, yy = q.Y * q.Y, zz = q.Z * q.Z;
+  const float xy = q.X * q.Y, xz = q.X * q.Z, yz = q.Y * q.Z;
+  const float wx = q.W * q.X, wy = q.W * q.Y, wz = q.W * q.Z;
+
+  PoseMatrix mtx;
+  mtx.rows[0] = Vector4A16(1.f - 2.f * (yy + zz), 2.f * (xy - wz),
+                           2.f * (xz + wy), 0.f) *
+                tm.scale.X;
+  mtx.rows[1] = Vector4A16(2.f * (xy + wz), 1.f - 2.f * (xx + zz),
+                           2.f * (yz - wx), 0.f) *
+                tm.scale.Y;
+  mtx.rows[2] = Vector4A16(2.f * (xz - wy), 2.f * (yz + wx),
+                           1.f - 2.f * (xx + yy), 0.f) *
+                tm.scale.Z;
+  mtx.rows[3] = Vector4A16(tm.translation.X, tm.translation.Y,
+                           tm.translation.Z, 1.f);
+
+  return mtx;
+}
+} // namespace revilmax
@@ -0,0 +1,40 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "datas/vectors_simd.hpp"
+
+namespace revilmax {
+// Local bone transform.
+// Rotation is a quaternion in 3ds Max convention, as output by PrepareSamples.
+struct BoneTransform {
+  Vector4A16 translation;
+  Vector4A16 rotation{0.f, 0.f, 0.f, 1.f};
+  Vector4A16 scale{1.f, 1.f, 1.f, 0.f};
+};
+
+// Affine matrix laid out as 3ds Max Matrix3, rows 0-2 are axes,
+// row 3 is translation. Points are transformed as row vectors.
+struct PoseMatrix {
+  Vector4A16 rows[4];
+};
+
+// Same result as Matrix3::SetRotate, SetScale and SetTrans combined
+PoseMatrix ToPoseMatrix(const BoneTransform &tm);
+} // namespace revilmax
@@ -0,0 +1,37 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "datas/flags.hpp"
+#include "datas/reflector.hpp"
+
+// Importer dialog and batch options, reflected into plugin config.
+// es::Flags stores bits in underlying type, it must hold every member.
+MAKE_ENUM(ENUMSCOPE(class Checked
+                    : uint16, Checked),
+          EMEMBER(RD_ANIALL), EMEMBER(RD_ANISEL), EMEMBER(CH_RESAMPLE),
+          EMEMBER(CH_ADDITIVE), EMEMBER(CH_DISABLEIK), EMEMBER(CH_NO_CACHE),
+          EMEMBER(CH_NOLOGBONES), EMEMBER(CH_MULTITHREAD),
+          EMEMBER(CH_REDUCEKEYS), EMEMBER(CH_NATIVEKEYS));
+
+static_assert(static_cast<size_t>(Checked::CH_NATIVEKEYS) <
+                  sizeof(Checked) * 8,
+              "Checked flags overflow underlying type");
+
+MAKE_ENUM(ENUMSCOPE(class Visible : uint8, Visible), EMEMBER(CB_MOTION));
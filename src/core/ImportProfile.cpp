@@ -0,0 +1,156 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "ImportProfile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace revilmax {
+static double ToMs(ImportProfile::Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static long long ToUs(ImportProfile::Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+void ImportProfile::Reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  start = Clock::now();
+  events.clear();
+  counters.clear();
+}
+
+void ImportProfile::AddPhase(const char *name, Clock::time_point begin) {
+  const Clock::time_point end = Clock::now();
+  std::lock_guard<std::mutex> lock(mutex);
+  events.push_back({name, begin, end, std::this_thread::get_id()});
+}
+
+void ImportProfile::Count(const char *name, size_t value) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto &c : counters) {
+    if (!strcmp(c.name, name)) {
+      c.value += value;
+      return;
+    }
+  }
+
+  counters.push_back({name, value});
+}
+
+bool ImportProfile::Empty() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return events.empty() && counters.empty();
+}
+
+std::string ImportProfile::Summary() const {
+  struct PhaseTotal {
+    const char *name;
+    size_t calls;
+    Clock::duration total;
+    Clock::duration longest;
+  };
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<PhaseTotal> totals;
+
+  // Phases are listed in order of first occurrence
+  for (auto &e : events) {
+    auto found = std::find_if(totals.begin(), totals.end(), [&](auto &t) {
+      return !strcmp(t.name, e.name);
+    });
+
+    if (found == totals.end()) {
+      totals.push_back({e.name, 0, {}, {}});
+      found = std::prev(totals.end());
+    }
+
+    const Clock::duration duration = e.end - e.begin;
+    found->calls++;
+    found->total += duration;
+    found->longest = std::max(found->longest, duration);
+  }
+
+  char line[128];
+  snprintf(line, sizeof(line), "Import profile, %.2f ms:\n",
+           ToMs(Clock::now() - start));
+  std::string text(line);
+  snprintf(line, sizeof(line), "  %-20s %8s %12s %12s\n", "phase", "calls",
+           "total ms", "max ms");
+  text.append(line);
+
+  for (auto &t : totals) {
+    snprintf(line, sizeof(line), "  %-20s %8zu %12.2f %12.2f\n", t.name,
+             t.calls, ToMs(t.total), ToMs(t.longest));
+    text.append(line);
+  }
+
+  for (auto &c : counters) {
+    snprintf(line, sizeof(line), "  %-20s %8zu\n", c.name, c.value);
+    text.append(line);
+  }
+
+  return text;
+}
+
+void ImportProfile::WriteTrace(std::ostream &str) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::thread::id> threads;
+  Clock::time_point end = start;
+  bool first = true;
+
+  auto separate = [&] {
+    if (!first) {
+      str << ",\n";
+    }
+
+    first = false;
+  };
+
+  str << "{\"traceEvents\":[\n";
+
+  for (auto &e : events) {
+    auto found = std::find(threads.begin(), threads.end(), e.thread);
+    const size_t tid = std::distance(threads.begin(), found);
+
+    if (found == threads.end()) {
+      threads.push_back(e.thread);
+    }
+
+    separate();
+    str << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+        << tid << ",\"ts\":" << ToUs(e.begin - start)
+        << ",\"dur\":" << ToUs(e.end - e.begin) << '}';
+    end = std::max(end, e.end);
+  }
+
+  // Counters are totals, placed at the end of import
+  for (auto &c : counters) {
+    separate();
+    str << "{\"name\":\"" << c.name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+        << ToUs(end - start) << ",\"args\":{\"value\":" << c.value << "}}";
+  }
+
+  str << "\n]}\n";
+}
+} // namespace revilmax
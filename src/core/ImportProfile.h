@@ -0,0 +1,85 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace revilmax {
+// Wall time of named import phases and import counters.
+// Phases and counters may be recorded from any thread, names are not copied
+// and must outlive profile.
+class ImportProfile {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ImportProfile() { Reset(); }
+
+  // Clears recorded data, import time starts now
+  void Reset();
+  // Phase from begin until now
+  void AddPhase(const char *name, Clock::time_point begin);
+  void Count(const char *name, size_t value = 1);
+  bool Empty() const;
+
+  // Table of calls, total and longest time per phase, then counters.
+  // Phases running on worker threads are summed, so they can add up to more
+  // than import time.
+  std::string Summary() const;
+  // Chrome trace event format, loadable in chrome://tracing or Perfetto
+  void WriteTrace(std::ostream &str) const;
+
+private:
+  struct Event {
+    const char *name;
+    Clock::time_point begin;
+    Clock::time_point end;
+    std::thread::id thread;
+  };
+
+  struct Counter {
+    const char *name;
+    size_t value;
+  };
+
+  mutable std::mutex mutex;
+  Clock::time_point start;
+  std::vector<Event> events;
+  std::vector<Counter> counters;
+};
+
+// Records enclosing scope as phase of profile
+class ScopedPhase {
+public:
+  ScopedPhase(ImportProfile &profile_, const char *name_)
+      : profile(profile_), name(name_), begin(ImportProfile::Clock::now()) {}
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase &operator=(const ScopedPhase &) = delete;
+  ~ScopedPhase() { profile.AddPhase(name, begin); }
+
+private:
+  ImportProfile &profile;
+  const char *name;
+  ImportProfile::Clock::time_point begin;
+};
+} // namespace revilmax
@@ -0,0 +1,320 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "KeyReducer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace revilmax {
+static constexpr float DEG_TO_RAD = 3.14159265f / 180.f;
+
+static float Dot4(const Vector4A16 &v0, const Vector4A16 &v1) {
+  return v0.X * v1.X + v0.Y * v1.Y + v0.Z * v1.Z + v0.W * v1.W;
+}
+
+static float Dot3(const Vector4A16 &v0, const Vector4A16 &v1) {
+  return v0.X * v1.X + v0.Y * v1.Y + v0.Z * v1.Z;
+}
+
+// Checks all frames in (begin, end) against interpolation of the boundaries
+template <class Fits>
+static bool SegmentFits(const Vector4A16 *values, size_t begin, size_t end,
+                        Fits &&fits) {
+  const float invSpan = 1.f / static_cast<float>(end - begin);
+
+  for (size_t i = begin + 1; i < end; i++) {
+    const float delta = static_cast<float>(i - begin) * invSpan;
+
+    if (!fits(values[begin], values[end], values[i], delta)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Slerp weights of both boundaries, q1 is already flipped into hemisphere
+// of q0. Close boundaries use nlerp, invLength then normalizes the result.
+struct SlerpWeights {
+  float cosTheta;
+  float theta = 0.f;
+  float invSin = 0.f;
+  bool linear;
+
+  explicit SlerpWeights(float cosTheta_)
+      : cosTheta(cosTheta_), linear(cosTheta_ > 0.9995f) {
+    if (!linear) {
+      theta = std::acos(cosTheta);
+      invSin = 1.f / std::sin(theta);
+    }
+  }
+
+  void Get(float delta, float &w0, float &w1, float &invLength) const {
+    if (linear) {
+      w0 = 1.f - delta;
+      w1 = delta;
+      invLength =
+          1.f / std::sqrt(w0 * w0 + w1 * w1 + 2.f * w0 * w1 * cosTheta);
+    } else {
+      w0 = std::sin((1.f - delta) * theta) * invSin;
+      w1 = std::sin(delta * theta) * invSin;
+      invLength = 1.f;
+    }
+  }
+};
+
+// Slerp between boundaries is checked against every frame in (begin, end).
+// Error is the squared distance of interpolation and frame flipped into the
+// same hemisphere. Unlike dot products close to 1, it keeps precision for
+// small tolerances. Frames are processed 4 at a time in transposed layout.
+static bool RotationSegmentFits(const Vector4A16 *values, size_t begin,
+                                size_t end, float maxError) {
+  const Vector4A16 &q0 = values[begin];
+  const float cosTheta = Dot4(q0, values[end]);
+  const float sign = cosTheta < 0.f ? -1.f : 1.f;
+  const Vector4A16 q1 = values[end] * sign;
+  const SlerpWeights slerp(cosTheta * sign);
+  const float invSpan = 1.f / static_cast<float>(end - begin);
+  size_t i = begin + 1;
+
+  const __m128 q0x = _mm_set1_ps(q0.X), q0y = _mm_set1_ps(q0.Y),
+               q0z = _mm_set1_ps(q0.Z), q0w = _mm_set1_ps(q0.W);
+  const __m128 q1x = _mm_set1_ps(q1.X), q1y = _mm_set1_ps(q1.Y),
+               q1z = _mm_set1_ps(q1.Z), q1w = _mm_set1_ps(q1.W);
+  const __m128 signBit = _mm_set1_ps(-0.f);
+  const __m128 vMaxError = _mm_set1_ps(maxError);
+
+  for (; i + 4 <= end; i += 4) {
+    alignas(16) float w0s[4], w1s[4], invLengths[4];
+
+    for (size_t l = 0; l < 4; l++) {
+      slerp.Get(static_cast<float>(i + l - begin) * invSpan, w0s[l], w1s[l],
+                invLengths[l]);
+    }
+
+    const __m128 invLength = _mm_load_ps(invLengths);
+    const __m128 w0 = _mm_mul_ps(_mm_load_ps(w0s), invLength);
+    const __m128 w1 = _mm_mul_ps(_mm_load_ps(w1s), invLength);
+    auto interp = [&](__m128 c0, __m128 c1) {
+      return _mm_add_ps(_mm_mul_ps(w0, c0), _mm_mul_ps(w1, c1));
+    };
+    const __m128 ix = interp(q0x, q1x), iy = interp(q0y, q1y),
+                 iz = interp(q0z, q1z), iw = interp(q0w, q1w);
+
+    __m128 x = values[i]._data, y = values[i + 1]._data,
+           z = values[i + 2]._data, w = values[i + 3]._data;
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    const __m128 dot =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ix, x), _mm_mul_ps(iy, y)),
+                   _mm_add_ps(_mm_mul_ps(iz, z), _mm_mul_ps(iw, w)));
+    const __m128 flip = _mm_and_ps(dot, signBit);
+    const __m128 rx = _mm_sub_ps(ix, _mm_xor_ps(x, flip));
+    const __m128 ry = _mm_sub_ps(iy, _mm_xor_ps(y, flip));
+    const __m128 rz = _mm_sub_ps(iz, _mm_xor_ps(z, flip));
+    const __m128 rw = _mm_sub_ps(iw, _mm_xor_ps(w, flip));
+    const __m128 error =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+                   _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+
+    if (_mm_movemask_ps(_mm_cmpgt_ps(error, vMaxError))) {
+      return false;
+    }
+  }
+
+  for (; i < end; i++) {
+    float w0, w1, invLength;
+    slerp.Get(static_cast<float>(i - begin) * invSpan, w0, w1, invLength);
+    const Vector4A16 interp = (q0 * w0 + q1 * w1) * invLength;
+    const Vector4A16 &value = values[i];
+    const Vector4A16 diff =
+        interp - (Dot4(interp, value) < 0.f ? value * -1.f : value);
+
+    if (Dot4(diff, diff) > maxError) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Segment is tested by segmentFits(begin, end)
+template <class SegmentFitsFunc>
+static std::vector<uint32> ReduceSegments(size_t numValues,
+                                          SegmentFitsFunc &&segmentFits) {
+  std::vector<uint32> keys;
+
+  if (!numValues) {
+    return keys;
+  }
+
+  keys.push_back(0);
+  size_t anchor = 0;
+  const size_t lastFrame = numValues - 1;
+
+  while (anchor < lastFrame) {
+    // Gallop to the first segment that doesn't fit, then bisect back
+    size_t good = anchor + 1;
+    size_t step = 1;
+    size_t bad = good;
+
+    while (true) {
+      const size_t probe = std::min(anchor + step * 2, lastFrame);
+
+      if (probe == good) {
+        bad = probe + 1;
+        break;
+      }
+
+      if (!segmentFits(anchor, probe)) {
+        bad = probe;
+        break;
+      }
+
+      good = probe;
+      step *= 2;
+    }
+
+    while (bad - good > 1) {
+      const size_t mid = good + (bad - good) / 2;
+
+      if (segmentFits(anchor, mid)) {
+        good = mid;
+      } else {
+        bad = mid;
+      }
+    }
+
+    keys.push_back(static_cast<uint32>(good));
+    anchor = good;
+  }
+
+  return keys;
+}
+
+template <class Fits>
+static std::vector<uint32> ReduceKeys(const Vector4A16 *values,
+                                      size_t numValues, Fits &&fits) {
+  return ReduceSegments(numValues, [&](size_t begin, size_t end) {
+    return SegmentFits(values, begin, end, fits);
+  });
+}
+
+std::vector<uint32> ReduceKeys(const Vector4A16 *values, size_t numValues,
+                               uni::MotionTrack::TrackType_e trackType,
+                               float tolerance) {
+  switch (trackType) {
+  case uni::MotionTrack::Position: {
+    const float maxError = tolerance * tolerance;
+    return ReduceKeys(values, numValues,
+                      [=](const Vector4A16 &v0, const Vector4A16 &v1,
+                          const Vector4A16 &value, float delta) {
+                        const Vector4A16 diff = v0 + (v1 - v0) * delta - value;
+                        return Dot3(diff, diff) <= maxError;
+                      });
+  }
+  case uni::MotionTrack::Rotation: {
+    // Rotation by angle a is a quaternion a / 2 away from the other,
+    // chord between them is 2 * sin(a / 4)
+    const float chord =
+        2.f * std::sin(std::min(tolerance, 360.f) * DEG_TO_RAD * 0.25f);
+    const float maxError = chord * chord;
+    return ReduceSegments(numValues, [=](size_t begin, size_t end) {
+      return RotationSegmentFits(values, begin, end, maxError);
+    });
+  }
+  case uni::MotionTrack::Scale:
+    return ReduceKeys(
+        values, numValues,
+        [=](const Vector4A16 &v0, const Vector4A16 &v1,
+            const Vector4A16 &value, float delta) {
+          const Vector4A16 interp = v0 + (v1 - v0) * delta;
+          const float interps[]{interp.X, interp.Y, interp.Z};
+          const float refs[]{value.X, value.Y, value.Z};
+
+          for (size_t c = 0; c < 3; c++) {
+            const float ref = std::max(std::abs(refs[c]), 1e-6f);
+
+            if (std::abs(interps[c] - refs[c]) > ref * tolerance) {
+              return false;
+            }
+          }
+
+          return true;
+        });
+  default: {
+    std::vector<uint32> keys(numValues);
+
+    for (size_t i = 0; i < numValues; i++) {
+      keys[i] = static_cast<uint32>(i);
+    }
+
+    return keys;
+  }
+  }
+}
+
+// Track is skipped when toleranceOf returns negative tolerance
+template <class ToleranceOf>
+static void ReduceTracks(MotionSamples &samples, WorkerPool *pool,
+                         ToleranceOf &&toleranceOf) {
+  auto reduceOne = [&](size_t index) {
+    TrackSamples &t = samples[index];
+    const float tolerance = toleranceOf(t.trackType);
+
+    if (tolerance < 0.f) {
+      return;
+    }
+
+    t.keyFrames =
+        ReduceKeys(t.values.data(), t.values.size(), t.trackType, tolerance);
+  };
+
+  if (pool) {
+    pool->ParallelFor(samples.size(), reduceOne);
+  } else {
+    for (size_t i = 0; i < samples.size(); i++) {
+      reduceOne(i);
+    }
+  }
+}
+
+void ReduceSamples(MotionSamples &samples, const ReduceTolerances &tolerances,
+                   WorkerPool *pool) {
+  ReduceTracks(samples, pool, [&](uni::MotionTrack::TrackType_e type) {
+    switch (type) {
+    case uni::MotionTrack::Position:
+      return tolerances.position;
+    case uni::MotionTrack::Rotation:
+      return tolerances.rotation;
+    case uni::MotionTrack::Scale:
+      return tolerances.scale;
+    default:
+      return -1.f;
+    }
+  });
+}
+
+void ReduceRotations(MotionSamples &samples, float tolerance,
+                     WorkerPool *pool) {
+  ReduceTracks(samples, pool, [=](uni::MotionTrack::TrackType_e type) {
+    return type == uni::MotionTrack::Rotation ? tolerance : -1.f;
+  });
+}
+} // namespace revilmax
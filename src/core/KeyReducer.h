@@ -0,0 +1,60 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "MotionSampler.h"
+
+namespace revilmax {
+struct ReduceTolerances {
+  // Scene units
+  float position = 0.01f;
+  // Degrees
+  float rotation = 0.1f;
+  // Relative difference
+  float scale = 0.001f;
+
+  // Drops only frames that are reproduced by interpolation,
+  // recovers source keys of linearly interpolated codecs.
+  static ReduceTolerances Lossless() {
+    ReduceTolerances retVal;
+    retVal.position = 1e-5f;
+    retVal.rotation = 1e-3f;
+    retVal.scale = 1e-6f;
+    return retVal;
+  }
+};
+
+// Selects the fewest frames, whose linear interpolation (slerp for
+// rotations) stays within tolerance for every dropped frame.
+// First and last frame are always kept.
+// Tolerance only holds for controllers interpolating keys the same way, see
+// SceneBackend::HasLinearKeys. Bezier tangents or per axis euler
+// interpolation between kept keys can stray further.
+std::vector<uint32> ReduceKeys(const Vector4A16 *values, size_t numValues,
+                               uni::MotionTrack::TrackType_e trackType,
+                               float tolerance);
+
+// Fills keyFrames of every position, rotation and scale track
+void ReduceSamples(MotionSamples &samples, const ReduceTolerances &tolerances,
+                   WorkerPool *pool = nullptr);
+// Fills keyFrames of rotation tracks only, tolerance is in degrees.
+// Static bones end up with two keys, fast ones keep every needed frame.
+void ReduceRotations(MotionSamples &samples, float tolerance,
+                     WorkerPool *pool = nullptr);
+} // namespace revilmax
@@ -0,0 +1,188 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "LogSink.h"
+
+namespace revilmax {
+static LogSink::Level LineLevel(const std::string &line) {
+  if (!line.compare(0, 5, "ERROR")) {
+    return LogSink::Level::Error;
+  }
+
+  if (!line.compare(0, 7, "WARNING")) {
+    return LogSink::Level::Warning;
+  }
+
+  return LogSink::Level::Info;
+}
+
+LogSink &LogSink::Get() {
+  static LogSink sink;
+  return sink;
+}
+
+void LogSink::SetOutput(OutputFunc func) {
+  std::lock_guard<std::mutex> lock(mutex);
+  output = std::move(func);
+  outputThread = std::this_thread::get_id();
+}
+
+void LogSink::FlushInterval(std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> lock(mutex);
+  flushInterval = interval;
+}
+
+void LogSink::MinLevel(Level level) {
+  std::lock_guard<std::mutex> lock(mutex);
+  minLevel = level;
+}
+
+void LogSink::Print(const char *msg) {
+  OutputFunc func;
+  std::string text;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.append(msg);
+    size_t lineBegin = 0;
+
+    for (size_t lineEnd = pending.find('\n'); lineEnd != std::string::npos;
+         lineEnd = pending.find('\n', lineBegin)) {
+      size_t lineSize = lineEnd - lineBegin;
+
+      if (lineSize && pending[lineEnd - 1] == '\r') {
+        lineSize--;
+      }
+
+      AddLine(pending.substr(lineBegin, lineSize));
+      lineBegin = lineEnd + 1;
+    }
+
+    pending.erase(0, lineBegin);
+
+    if (entries.empty() || !output ||
+        std::this_thread::get_id() != outputThread) {
+      return;
+    }
+
+    const bool expired =
+        std::chrono::steady_clock::now() - firstBuffered >= flushInterval;
+
+    if (!expired && entries.size() < maxLines) {
+      return;
+    }
+
+    func = output;
+    text = TakeText();
+  }
+
+  func(text);
+}
+
+void LogSink::Add(Level level, const std::string &line) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  switch (level) {
+  case Level::Error:
+    AddLine("ERROR: " + line);
+    break;
+  case Level::Warning:
+    AddLine("WARNING: " + line);
+    break;
+  default:
+    AddLine(line);
+    break;
+  }
+}
+
+void LogSink::Flush() {
+  OutputFunc func;
+  std::string text;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!output) {
+      return;
+    }
+
+    if (!pending.empty()) {
+      std::string line;
+      line.swap(pending);
+      AddLine(std::move(line));
+    }
+
+    func = output;
+    text = TakeText();
+  }
+
+  if (!text.empty()) {
+    func(text);
+  }
+}
+
+void LogSink::AddLine(std::string line) {
+  const Level level = LineLevel(line);
+
+  if (level < minLevel) {
+    return;
+  }
+
+  if (entries.empty()) {
+    firstBuffered = std::chrono::steady_clock::now();
+  }
+
+  if (level != Level::Info) {
+    auto found = repeated.find(line);
+
+    if (found != repeated.end()) {
+      entries[found->second].count++;
+      return;
+    }
+
+    repeated.emplace(line, entries.size());
+  } else if (!line.empty() && !entries.empty() &&
+             entries.back().level == Level::Info &&
+             entries.back().text == line) {
+    entries.back().count++;
+    return;
+  }
+
+  entries.push_back({level, std::move(line), 1});
+}
+
+std::string LogSink::TakeText() {
+  std::string text;
+
+  for (auto &e : entries) {
+    text.append(e.text);
+
+    if (e.count > 1) {
+      text.append(" (x" + std::to_string(e.count) + ")");
+    }
+
+    text.push_back('\n');
+  }
+
+  entries.clear();
+  repeated.clear();
+
+  return text;
+}
+} // namespace revilmax
@@ -0,0 +1,88 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace revilmax {
+// Buffers log lines and hands them to output in batches.
+// Repeated warnings and errors are merged into a single line with a repeat
+// count, repeated info lines only when they follow each other.
+class LogSink {
+public:
+  enum class Level { Info, Warning, Error };
+  using OutputFunc = std::function<void(const std::string &text)>;
+
+  // Buffered lines are written on Flush, or by Print once they are older
+  // than flushInterval or too many distinct lines are buffered.
+  // Print only writes on the thread that set output, other threads wait
+  // for the next Flush.
+  void SetOutput(OutputFunc func);
+  void FlushInterval(std::chrono::milliseconds interval);
+  // Lines below level are dropped
+  void MinLevel(Level level);
+
+  // Printer callback, msg may hold several or incomplete lines.
+  // Level is taken from ERROR/WARNING prefix of a line.
+  void Print(const char *msg);
+  void Add(Level level, const std::string &line);
+  void Flush();
+
+  // Shared sink, created on first use
+  static LogSink &Get();
+
+private:
+  struct Entry {
+    Level level;
+    std::string text;
+    size_t count;
+  };
+
+  std::mutex mutex;
+  OutputFunc output;
+  std::thread::id outputThread;
+  std::chrono::milliseconds flushInterval{500};
+  std::chrono::steady_clock::time_point firstBuffered;
+  Level minLevel = Level::Info;
+  size_t maxLines = 256;
+  // Text after last line break
+  std::string pending;
+  std::vector<Entry> entries;
+  // Warning and error lines to their entry index
+  std::unordered_map<std::string, size_t> repeated;
+
+  void AddLine(std::string line);
+  std::string TakeText();
+};
+
+// Flushes shared sink on leaving scope, whichever way it is left
+class ScopedFlush {
+public:
+  ScopedFlush() = default;
+  ScopedFlush(const ScopedFlush &) = delete;
+  ScopedFlush &operator=(const ScopedFlush &) = delete;
+  ~ScopedFlush() { LogSink::Get().Flush(); }
+};
+} // namespace revilmax
@@ -0,0 +1,154 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "MappedFile.h"
+#include "datas/except.hpp"
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace revilmax {
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+  const auto wPath = std::filesystem::u8path(path);
+  HANDLE hFile = CreateFileW(wPath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+  if (hFile == INVALID_HANDLE_VALUE) {
+    throw es::FileNotFoundError(path);
+  }
+
+  fileHandle = hFile;
+  LARGE_INTEGER fileSize;
+
+  if (!GetFileSizeEx(hFile, &fileSize) || !fileSize.QuadPart) {
+    return;
+  }
+
+  size = static_cast<size_t>(fileSize.QuadPart);
+  HANDLE hMapping =
+      CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  if (!hMapping) {
+    CloseHandle(hFile);
+    throw es::FileNotFoundError(path);
+  }
+
+  mappingHandle = hMapping;
+  data = static_cast<const char *>(
+      MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+
+  if (!data) {
+    CloseHandle(hMapping);
+    CloseHandle(hFile);
+    throw es::FileNotFoundError(path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    UnmapViewOfFile(data);
+  }
+
+  if (mappingHandle) {
+    CloseHandle(mappingHandle);
+  }
+
+  if (fileHandle) {
+    CloseHandle(fileHandle);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    throw es::FileNotFoundError(path);
+  }
+
+  struct stat fileStat;
+
+  if (fstat(fd, &fileStat) || !fileStat.st_size) {
+    close(fd);
+    return;
+  }
+
+  size = static_cast<size_t>(fileStat.st_size);
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    throw es::FileNotFoundError(path);
+  }
+
+  data = static_cast<const char *>(mapped);
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+#endif
+
+MappedStreamBuf::MappedStreamBuf(const char *data, size_t size) {
+  char *begin = const_cast<char *>(data);
+  setg(begin, begin, begin + size);
+}
+
+MappedStreamBuf::pos_type
+MappedStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                         std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+
+  off_type base = 0;
+
+  if (dir == std::ios_base::cur) {
+    base = gptr() - eback();
+  } else if (dir == std::ios_base::end) {
+    base = egptr() - eback();
+  }
+
+  const off_type newPos = base + off;
+
+  if (newPos < 0 || newPos > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+
+  setg(eback(), eback() + newPos, egptr());
+  return pos_type(newPos);
+}
+
+MappedStreamBuf::pos_type
+MappedStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+} // namespace revilmax
@@ -0,0 +1,68 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include <istream>
+#include <streambuf>
+#include <string>
+
+namespace revilmax {
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  // Path is UTF-8, throws es::FileNotFoundError
+  explicit MappedFile(const std::string &path);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  const char *Data() const { return data; }
+  size_t Size() const { return size; }
+
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mappingHandle = nullptr;
+#endif
+};
+
+// Seekable stream over a mapping, reads are served from mapped pages
+// without an intermediate file buffer. Readers still copy what they read,
+// nothing is resolved in place.
+class MappedStreamBuf : public std::streambuf {
+public:
+  MappedStreamBuf(const char *data, size_t size);
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+class MappedStream : public std::istream {
+public:
+  explicit MappedStream(const MappedFile &file)
+      : std::istream(&buffer), buffer(file.Data(), file.Size()) {}
+
+private:
+  MappedStreamBuf buffer;
+};
+} // namespace revilmax
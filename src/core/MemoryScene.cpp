@@ -0,0 +1,320 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "MemoryScene.h"
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+
+namespace revilmax {
+using KeyMap = std::map<int32, Vector4A16>;
+
+// Linear between surrounding keys, slerp for rotations, same as linear
+// controllers in 3ds Max.
+// Outside of keyed range value of nearest key is held.
+static Vector4A16 EvaluateKeys(const KeyMap &keys, int32 time,
+                               const Vector4A16 &fallback, bool rotation) {
+  if (keys.empty()) {
+    return fallback;
+  }
+
+  auto next = keys.lower_bound(time);
+
+  if (next == keys.end()) {
+    return std::prev(next)->second;
+  }
+
+  if (next->first == time || next == keys.begin()) {
+    return next->second;
+  }
+
+  auto prev = std::prev(next);
+  const float delta = static_cast<float>(time - prev->first) /
+                      static_cast<float>(next->first - prev->first);
+  const Vector4A16 &a = prev->second;
+  Vector4A16 b = next->second;
+
+  if (!rotation) {
+    return a + (b - a) * delta;
+  }
+
+  float dot = a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W;
+
+  if (dot < 0.f) {
+    b *= -1.f;
+    dot = -dot;
+  }
+
+  if (dot > 0.9995f) {
+    Vector4A16 result = a + (b - a) * delta;
+    result.Normalize();
+    return result;
+  }
+
+  const float theta = std::acos(dot);
+  const float invSin = 1.f / std::sin(theta);
+
+  return a * (std::sin((1.f - delta) * theta) * invSin) +
+         b * (std::sin(delta * theta) * invSin);
+}
+
+MemoryScene::Node MemoryScene::FindNode(const std::string &name) {
+  auto found = names.find(name);
+  return found == names.end() ? NO_NODE : found->second;
+}
+
+MemoryScene::Node MemoryScene::CreateBone(const std::string &name) {
+  const Node node = static_cast<Node>(nodes.size());
+  nodes.emplace_back();
+  nodes.back().name = name;
+  names.emplace(name, node);
+
+  return node;
+}
+
+void MemoryScene::SetParent(Node node, Node parent) {
+  nodes[node].parent = parent;
+}
+
+std::vector<MemoryScene::Node> MemoryScene::Children(Node node) {
+  std::vector<Node> children;
+
+  for (size_t n = 0; n < nodes.size(); n++) {
+    if (nodes[n].parent == node) {
+      children.push_back(static_cast<Node>(n));
+    }
+  }
+
+  return children;
+}
+
+void MemoryScene::CloneNodes(const Node *nodes_, size_t numNodes,
+                             const std::string &suffix, Node *clones) {
+  for (size_t n = 0; n < numNodes; n++) {
+    const Node clone = static_cast<Node>(nodes.size());
+    NodeRecord record = nodes[nodes_[n]];
+    record.name += suffix;
+    names.emplace(record.name, clone);
+    nodes.push_back(std::move(record));
+    clones[n] = clone;
+  }
+}
+
+void MemoryScene::SetUserProp(Node node, const std::string &key,
+                              const std::string &value) {
+  nodes[node].userProps[key] = value;
+}
+
+bool MemoryScene::GetUserProp(Node node, const std::string &key,
+                              std::string &value) {
+  const auto &props = nodes[node].userProps;
+  auto found = props.find(key);
+
+  if (found == props.end()) {
+    return false;
+  }
+
+  value = found->second;
+
+  return true;
+}
+
+bool MemoryScene::GetUserProp(Node node, const std::string &key,
+                              int32 &value) {
+  std::string str;
+
+  if (!GetUserProp(node, key, str)) {
+    return false;
+  }
+
+  char *end = nullptr;
+  const long parsed = std::strtol(str.c_str(), &end, 10);
+
+  if (end == str.c_str()) {
+    return false;
+  }
+
+  value = static_cast<int32>(parsed);
+
+  return true;
+}
+
+bool MemoryScene::GetUserProp(Node node, const std::string &key,
+                              bool &value) {
+  std::string str;
+
+  if (!GetUserProp(node, key, str)) {
+    return false;
+  }
+
+  if (str == "true" || str == "1") {
+    value = true;
+  } else if (str == "false" || str == "0") {
+    value = false;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+bool MemoryScene::GetUserData(Node node, uint32 id,
+                              std::vector<char> &data) {
+  const auto &userData = nodes[node].userData;
+  auto found = userData.find(id);
+
+  if (found == userData.end()) {
+    return false;
+  }
+
+  data = found->second;
+
+  return true;
+}
+
+void MemoryScene::SetUserData(Node node, uint32 id, const void *data,
+                              size_t size) {
+  const char *begin = static_cast<const char *>(data);
+  nodes[node].userData[id].assign(begin, begin + size);
+}
+
+BoneTransform MemoryScene::LocalTransform(Node node, int32 time) {
+  const NodeRecord &record = nodes[node];
+  const BoneTransform identity;
+  BoneTransform tm;
+  tm.translation =
+      EvaluateKeys(record.position, time, identity.translation, false);
+  tm.rotation = EvaluateKeys(record.rotation, time, identity.rotation, true);
+  tm.scale = EvaluateKeys(record.scale, time, identity.scale, false);
+
+  return tm;
+}
+
+void MemoryScene::SetLocalTransform(Node node, int32 time,
+                                    const BoneTransform &tm) {
+  NodeRecord &record = nodes[node];
+  record.position[time] = tm.translation;
+  record.rotation[time] = tm.rotation;
+  record.scale[time] = tm.scale;
+}
+
+void MemoryScene::CommitKeys(Node node, uni::MotionTrack::TrackType_e type,
+                             const int32 *times, const Vector4A16 *values,
+                             size_t numKeys) {
+  if (!numKeys) {
+    return;
+  }
+
+  NodeRecord &record = nodes[node];
+  KeyMap *keys = nullptr;
+
+  switch (type) {
+  case uni::MotionTrack::Position:
+    keys = &record.position;
+    break;
+  case uni::MotionTrack::Rotation:
+    keys = &record.rotation;
+    break;
+  case uni::MotionTrack::Scale:
+    keys = &record.scale;
+    break;
+  default:
+    return;
+  }
+
+  keys->erase(keys->lower_bound(times[0]),
+              keys->upper_bound(times[numKeys - 1]));
+
+  for (size_t k = 0; k < numKeys; k++) {
+    keys->emplace_hint(keys->end(), times[k], values[k]);
+  }
+}
+
+void MemoryScene::DeleteKeys(Node node) {
+  NodeRecord &record = nodes[node];
+  record.position.clear();
+  record.rotation.clear();
+  record.scale.clear();
+}
+
+size_t MemoryScene::NumKeys() const {
+  size_t numKeys = 0;
+
+  for (auto &n : nodes) {
+    numKeys += n.position.size() + n.rotation.size() + n.scale.size();
+  }
+
+  return numKeys;
+}
+
+void MemoryScene::Clear() {
+  nodes.clear();
+  names.clear();
+}
+
+void MemoryScene::Dump(std::ostream &str) const {
+  auto dumpKeys = [&](const char *name, const KeyMap &keys, bool rotation) {
+    if (keys.empty()) {
+      return;
+    }
+
+    str << "  " << name << ' ' << keys.size() << '\n';
+
+    for (auto &k : keys) {
+      str << "    " << k.first << ' ' << k.second.X << ' ' << k.second.Y
+          << ' ' << k.second.Z;
+
+      if (rotation) {
+        str << ' ' << k.second.W;
+      }
+
+      str << '\n';
+    }
+  };
+
+  const auto flags = str.flags();
+  const auto precision = str.precision();
+  str << std::fixed << std::setprecision(5);
+
+  for (size_t n = 0; n < nodes.size(); n++) {
+    const NodeRecord &record = nodes[n];
+    str << "node " << n << ' ' << record.name << " parent " << record.parent
+        << '\n';
+
+    for (auto &p : record.userProps) {
+      str << "  prop " << p.first << " = " << p.second << '\n';
+    }
+
+    for (auto &d : record.userData) {
+      str << "  data " << d.first << ' ' << d.second.size() << '\n';
+    }
+
+    if (!record.ikEnabled) {
+      str << "  ik disabled\n";
+    }
+
+    dumpKeys("position", record.position, false);
+    dumpKeys("rotation", record.rotation, true);
+    dumpKeys("scale", record.scale, false);
+  }
+
+  str.flags(flags);
+  str.precision(precision);
+}
+} // namespace revilmax
@@ -0,0 +1,91 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "SceneBackend.h"
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace revilmax {
+// In memory scene, records nodes, hierarchy, user properties, user data and
+// keys.
+// Stands in for 3ds Max when import logic runs headless, Dump output serves
+// as golden file for comparing imports.
+class MemoryScene : public SceneBackend {
+public:
+  struct NodeRecord {
+    std::string name;
+    Node parent = NO_NODE;
+    std::map<std::string, std::string> userProps;
+    std::map<uint32, std::vector<char>> userData;
+    bool ikEnabled = true;
+    // Keys by time, W is unused for position and scale
+    std::map<int32, Vector4A16> position;
+    std::map<int32, Vector4A16> rotation;
+    std::map<int32, Vector4A16> scale;
+  };
+
+  Node FindNode(const std::string &name) override;
+  Node CreateBone(const std::string &name) override;
+  void PrepareBone(Node) override {}
+  bool HasLinearKeys(Node, uni::MotionTrack::TrackType_e) override {
+    return true;
+  }
+  Node Parent(Node node) override { return nodes[node].parent; }
+  void SetParent(Node node, Node parent) override;
+  std::vector<Node> Children(Node node) override;
+  void CloneNodes(const Node *nodes, size_t numNodes,
+                  const std::string &suffix, Node *clones) override;
+  void SetUserProp(Node node, const std::string &key,
+                   const std::string &value) override;
+  bool GetUserProp(Node node, const std::string &key,
+                   std::string &value) override;
+  bool GetUserProp(Node node, const std::string &key, int32 &value) override;
+  bool GetUserProp(Node node, const std::string &key, bool &value) override;
+  bool GetUserData(Node node, uint32 id, std::vector<char> &data) override;
+  void SetUserData(Node node, uint32 id, const void *data,
+                   size_t size) override;
+  void ClearUserData(Node node, uint32 id) override {
+    nodes[node].userData.erase(id);
+  }
+  void SetIKEnabled(Node node, bool enabled) override {
+    nodes[node].ikEnabled = enabled;
+  }
+  BoneTransform LocalTransform(Node node, int32 time) override;
+  void SetLocalTransform(Node node, int32 time,
+                         const BoneTransform &tm) override;
+  void CommitKeys(Node node, uni::MotionTrack::TrackType_e type,
+                  const int32 *times, const Vector4A16 *values,
+                  size_t numKeys) override;
+  void DeleteKeys(Node node) override;
+
+  const std::vector<NodeRecord> &Nodes() const { return nodes; }
+  size_t NumKeys() const;
+  void Clear();
+  // Every node in creation order with its user properties, user data sizes
+  // and keys
+  void Dump(std::ostream &str) const;
+
+private:
+  std::vector<NodeRecord> nodes;
+  std::unordered_map<std::string, Node> names;
+};
+} // namespace revilmax
@@ -0,0 +1,81 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "MotionPrefetch.h"
+
+namespace revilmax {
+void MotionPrefetch::Start(size_t key_, uni::Element<const uni::Motion> motion_,
+                           std::shared_ptr<void> owner_, FrameGrid grid_,
+                           WorkerPool *pool) {
+  Cancel();
+  key = key_;
+  owner = std::move(owner_);
+  motion = std::move(motion_);
+  grid = std::move(grid_);
+  cancelled = false;
+
+  worker = std::thread([this, pool] {
+    try {
+      MotionSamples result = SampleMotion(*motion, grid, pool, &cancelled);
+
+      if (!cancelled) {
+        samples = std::move(result);
+        ready = true;
+      }
+    } catch (...) {
+      // Import will sample again and report the error
+    }
+  });
+}
+
+void MotionPrefetch::Wait() {
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void MotionPrefetch::Cancel() {
+  cancelled = true;
+  Wait();
+  Reset();
+}
+
+void MotionPrefetch::Reset() {
+  motion.reset();
+  owner.reset();
+  grid = {};
+  samples.clear();
+  ready = false;
+}
+
+bool MotionPrefetch::Take(size_t key_, const FrameGrid &grid_,
+                          MotionSamples &output) {
+  Wait();
+  const bool matches = ready && key == key_ && grid.secs == grid_.secs;
+
+  if (matches) {
+    output = std::move(samples);
+  }
+
+  // Motion is kept, taken samples refer to its tracks
+  samples.clear();
+  ready = false;
+  return matches;
+}
+} // namespace revilmax
@@ -0,0 +1,64 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "MotionSampler.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace revilmax {
+// Samples one motion on a background thread ahead of import,
+// so that only key commit is left once user confirms import dialog.
+class MotionPrefetch {
+public:
+  MotionPrefetch() = default;
+  MotionPrefetch(const MotionPrefetch &) = delete;
+  MotionPrefetch &operator=(const MotionPrefetch &) = delete;
+  ~MotionPrefetch() { Cancel(); }
+
+  // Cancels previous job and starts sampling motion at grid frames.
+  // Key identifies motion within its list, owner is the asset holding motion
+  // and is kept alive together with it.
+  void Start(size_t key, uni::Element<const uni::Motion> motion,
+             std::shared_ptr<void> owner, FrameGrid grid,
+             WorkerPool *pool = nullptr);
+  // Stops running job and drops its result
+  void Cancel();
+  // Blocks until running job is done, result is kept for Take
+  void Wait();
+  // Waits for job and moves out its samples when they were made for key at
+  // the same frame times. Result is dropped afterwards in any case, motion is
+  // kept until next Start or Cancel.
+  bool Take(size_t key, const FrameGrid &grid, MotionSamples &output);
+
+private:
+  std::thread worker;
+  std::atomic<bool> cancelled{false};
+  size_t key = 0;
+  std::shared_ptr<void> owner;
+  uni::Element<const uni::Motion> motion;
+  FrameGrid grid;
+  MotionSamples samples;
+  // Written by worker, read only after join
+  bool ready = false;
+
+  void Reset();
+};
+} // namespace revilmax
@@ -0,0 +1,160 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "MotionSampler.h"
+#include <cmath>
+
+namespace revilmax {
+FrameGrid BuildFrameGrid(float duration, int32 ticksPerFrame, int32 startTime,
+                         bool includeEndFrame) {
+  FrameGrid grid;
+  grid.ticksPerFrame = ticksPerFrame;
+
+  int32 numTicks = SecondsToTicks(duration);
+
+  if (includeEndFrame) {
+    numTicks += ticksPerFrame;
+  }
+
+  const int32 overlappingTicks = numTicks % ticksPerFrame;
+
+  if (overlappingTicks > (ticksPerFrame / 2)) {
+    numTicks += ticksPerFrame - overlappingTicks;
+  } else {
+    numTicks -= overlappingTicks;
+  }
+
+  grid.start = startTime;
+  grid.end = startTime + numTicks - ticksPerFrame;
+
+  for (int32 v = grid.start; v <= grid.end; v += ticksPerFrame) {
+    grid.secs.push_back(TicksToSeconds(v - startTime));
+    grid.ticks.push_back(v);
+  }
+
+  return grid;
+}
+
+void GetTrackValues(const uni::MotionTrack &track, const float *times,
+                    size_t numTimes, Vector4A16 *output) {
+  for (size_t i = 0; i < numTimes; i++) {
+    track.GetValue(output[i], times[i]);
+  }
+}
+
+MotionSamples SampleMotion(const uni::Motion &mot, const FrameGrid &grid,
+                           WorkerPool *pool, const std::atomic<bool> *cancel) {
+  MotionSamples samples;
+  const size_t numFrames = grid.NumFrames();
+
+  for (auto &t : mot) {
+    TrackSamples tSamples;
+    tSamples.track = t.get();
+    tSamples.boneIndex = t->BoneIndex();
+    tSamples.trackType = t->TrackType();
+    tSamples.values.resize(numFrames);
+    samples.emplace_back(std::move(tSamples));
+  }
+
+  auto sampleOne = [&](size_t index) {
+    if (cancel && *cancel) {
+      return;
+    }
+
+    TrackSamples &tSamples = samples[index];
+    GetTrackValues(*tSamples.track, grid.secs.data(), numFrames,
+                   tSamples.values.data());
+  };
+
+  if (pool) {
+    pool->ParallelFor(samples.size(), sampleOne);
+  } else {
+    for (size_t i = 0; i < samples.size(); i++) {
+      sampleOne(i);
+    }
+  }
+
+  return samples;
+}
+
+void ScaleSamples(Vector4A16 *values, size_t numValues, float scale) {
+  const Vector4A16 vScale(scale);
+
+  for (size_t i = 0; i < numValues; i++) {
+    values[i] *= vScale;
+  }
+}
+
+void ConjugateSamples(Vector4A16 *values, size_t numValues) {
+  const Vector4A16 conjugator(-1.f, -1.f, -1.f, 1.f);
+
+  for (size_t i = 0; i < numValues; i++) {
+    values[i] *= conjugator;
+  }
+}
+
+void MultiplySamples(Vector4A16 *values, const Vector4A16 *factors,
+                     size_t numValues) {
+  for (size_t i = 0; i < numValues; i++) {
+    values[i] *= factors[i];
+  }
+}
+
+// Lanes are picked from the same vector, _MM_SHUFFLE lists them from W to X
+template <int mask> static Vector4A16 Swizzle(const Vector4A16 &value) {
+  return _mm_shuffle_ps(value._data, value._data, mask);
+}
+
+void CorrectRootPositions(Vector4A16 *values, size_t numValues) {
+  const Vector4A16 signs(1.f, -1.f, 1.f, 1.f);
+
+  for (size_t i = 0; i < numValues; i++) {
+    values[i] = Swizzle<_MM_SHUFFLE(3, 1, 2, 0)>(values[i]) * signs;
+  }
+}
+
+// Product with constant quaternion expands to
+// sqrt(0.5) * (x - w, y - z, y + z, w + x)
+void CorrectRootRotations(Vector4A16 *values, size_t numValues) {
+  const float halfSqrt2 = std::sqrt(0.5f);
+  const Vector4A16 lhsFactor(halfSqrt2);
+  const Vector4A16 rhsFactor(-halfSqrt2, -halfSqrt2, halfSqrt2, halfSqrt2);
+
+  for (size_t i = 0; i < numValues; i++) {
+    const Vector4A16 lhs = Swizzle<_MM_SHUFFLE(3, 1, 1, 0)>(values[i]);
+    const Vector4A16 rhs = Swizzle<_MM_SHUFFLE(0, 2, 2, 3)>(values[i]);
+    values[i] = lhs * lhsFactor + rhs * rhsFactor;
+  }
+}
+
+void PrepareSamples(MotionSamples &samples, float positionScale) {
+  for (auto &t : samples) {
+    switch (t.trackType) {
+    case uni::MotionTrack::Position:
+      ScaleSamples(t.values.data(), t.values.size(), positionScale);
+      break;
+    case uni::MotionTrack::Rotation:
+      ConjugateSamples(t.values.data(), t.values.size());
+      break;
+    default:
+      break;
+    }
+  }
+}
+} // namespace revilmax
@@ -0,0 +1,107 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "WorkerPool.h"
+#include "datas/vectors_simd.hpp"
+#include "uni/motion.hpp"
+#include <atomic>
+#include <vector>
+
+// Host independent part of motion import, must not depend on 3ds Max SDK
+namespace revilmax {
+// Same as TIME_TICKSPERSEC in 3ds Max
+static constexpr int32 TICKS_PER_SEC = 4800;
+
+inline int32 SecondsToTicks(float secs) {
+  return static_cast<int32>(secs * TICKS_PER_SEC);
+}
+
+inline float TicksToSeconds(int32 ticks) {
+  return static_cast<float>(ticks) / TICKS_PER_SEC;
+}
+
+struct FrameGrid {
+  int32 start = 0;
+  int32 end = 0;
+  int32 ticksPerFrame = 0;
+  // Local motion time for every frame
+  std::vector<float> secs;
+  // Absolute scene time for every frame
+  std::vector<int32> ticks;
+
+  size_t NumFrames() const { return ticks.size(); }
+  // Single frame motions still span one frame on timeline
+  int32 RangeEnd() const { return end == start ? end + ticksPerFrame : end; }
+  // Start of the following motion when laid out back to back
+  int32 NextStart() const { return RangeEnd() + ticksPerFrame; }
+};
+
+// Duration is snapped to the nearest frame.
+// MTF motions end one frame before duration, RE motions include it.
+FrameGrid BuildFrameGrid(float duration, int32 ticksPerFrame, int32 startTime,
+                         bool includeEndFrame);
+
+struct TrackSamples {
+  const uni::MotionTrack *track;
+  size_t boneIndex;
+  uni::MotionTrack::TrackType_e trackType;
+  std::vector<Vector4A16> values;
+  // Frame indices to be written as keys, every frame if empty
+  std::vector<uint32> keyFrames;
+
+  size_t NumKeys() const {
+    return keyFrames.empty() ? values.size() : keyFrames.size();
+  }
+
+  size_t KeyFrame(size_t key) const {
+    return keyFrames.empty() ? key : keyFrames[key];
+  }
+};
+
+using MotionSamples = std::vector<TrackSamples>;
+
+// Calls GetValue of track for every time, into contiguous output.
+// Output must hold numTimes values.
+void GetTrackValues(const uni::MotionTrack &track, const float *times,
+                    size_t numTimes, Vector4A16 *output);
+
+// Evaluates every track of motion at every frame of grid.
+// Buffers are allocated upfront, tracks are sampled concurrently on pool if
+// provided.
+// Remaining tracks are skipped once cancel is set, result is then incomplete.
+MotionSamples SampleMotion(const uni::Motion &mot, const FrameGrid &grid,
+                           WorkerPool *pool = nullptr,
+                           const std::atomic<bool> *cancel = nullptr);
+
+// Whole buffer kernels, applied after sampling instead of per key
+void ScaleSamples(Vector4A16 *values, size_t numValues, float scale);
+void ConjugateSamples(Vector4A16 *values, size_t numValues);
+// Component wise values[i] *= factors[i]
+void MultiplySamples(Vector4A16 *values, const Vector4A16 *factors,
+                     size_t numValues);
+// Root bone values from Y up into 3ds Max Z up space, same as multiplying
+// by matrix with rows (1, 0, 0), (0, 0, 1), (0, -1, 0).
+// Points become (x, -z, y), rotations q * (-sqrt(0.5), 0, 0, sqrt(0.5)).
+void CorrectRootPositions(Vector4A16 *values, size_t numValues);
+void CorrectRootRotations(Vector4A16 *values, size_t numValues);
+
+// Applies positionScale to position tracks and conjugates rotation tracks
+void PrepareSamples(MotionSamples &samples, float positionScale);
+} // namespace revilmax
@@ -0,0 +1,91 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "BoneTransform.h"
+#include "uni/motion.hpp"
+#include <string>
+#include <vector>
+
+namespace revilmax {
+// Scene operations performed by importers.
+// Implemented on top of 3ds Max and by MemoryScene, so import logic can run
+// without host. Values are in 3ds Max conventions, times are in ticks.
+class SceneBackend {
+public:
+  // Handle of scene node, valid for lifetime of backend
+  using Node = int32;
+  static constexpr Node NO_NODE = -1;
+
+  virtual ~SceneBackend() = default;
+
+  // NO_NODE if not found
+  virtual Node FindNode(const std::string &name) = 0;
+  // Bone helper node
+  virtual Node CreateBone(const std::string &name) = 0;
+  // Sets linear position, rotation and scale controllers.
+  // Only for bones owned by importer, controllers of other nodes are kept.
+  virtual void PrepareBone(Node node) = 0;
+  // True if keys committed to track interpolate linearly, slerp for
+  // rotations. Reduced keys are fitted that way, other tracks have to be
+  // keyed at every frame.
+  virtual bool HasLinearKeys(Node node,
+                             uni::MotionTrack::TrackType_e type) = 0;
+  // NO_NODE for scene root
+  virtual Node Parent(Node node) = 0;
+  virtual void SetParent(Node node, Node parent) = 0;
+  // Direct children in scene order
+  virtual std::vector<Node> Children(Node node) = 0;
+  // Copies nodes with their keys and properties, but without children.
+  // Copies are named with suffix appended and placed under parents of
+  // originals, clones receives numNodes handles.
+  virtual void CloneNodes(const Node *nodes, size_t numNodes,
+                          const std::string &suffix, Node *clones) = 0;
+  virtual void SetUserProp(Node node, const std::string &key,
+                           const std::string &value) = 0;
+  // False if property is missing or can't be parsed as value type
+  virtual bool GetUserProp(Node node, const std::string &key,
+                           std::string &value) = 0;
+  virtual bool GetUserProp(Node node, const std::string &key,
+                           int32 &value) = 0;
+  virtual bool GetUserProp(Node node, const std::string &key,
+                           bool &value) = 0;
+  // Binary data of importer stored with node under id.
+  // False if node has no such data.
+  virtual bool GetUserData(Node node, uint32 id, std::vector<char> &data) = 0;
+  virtual void SetUserData(Node node, uint32 id, const void *data,
+                           size_t size) = 0;
+  virtual void ClearUserData(Node node, uint32 id) = 0;
+  // Toggles IK chain driven by node, nodes without IK chain are ignored
+  virtual void SetIKEnabled(Node node, bool enabled) = 0;
+
+  // Transform relative to parent at time, -1 holds rest pose
+  virtual BoneTransform LocalTransform(Node node, int32 time) = 0;
+  // Keys whole transform relative to parent
+  virtual void SetLocalTransform(Node node, int32 time,
+                                 const BoneTransform &tm) = 0;
+  // Keys in range of times are replaced, times must be ascending.
+  // W of position and scale values is ignored.
+  virtual void CommitKeys(Node node, uni::MotionTrack::TrackType_e type,
+                          const int32 *times, const Vector4A16 *values,
+                          size_t numKeys) = 0;
+  // Removes all position, rotation and scale keys
+  virtual void DeleteKeys(Node node) = 0;
+};
+} // namespace revilmax
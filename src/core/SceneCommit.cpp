@@ -0,0 +1,153 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "SceneCommit.h"
+#include "datas/master_printer.hpp"
+#include "uni/rts.hpp"
+
+namespace revilmax {
+void ImportSkeleton(SceneBackend &scene, const uni::Skeleton &skel,
+                    int32 startTime, const SkeletonImportSettings &settings,
+                    BoneNodes &nodes) {
+  for (auto &b : skel) {
+    const std::string boneName = b->Name();
+    SceneBackend::Node node = scene.FindNode(boneName);
+
+    if (node == SceneBackend::NO_NODE) {
+      if (settings.additive) {
+        if (settings.logMissingBones) {
+          printerror("Cannot find bone: " << boneName);
+        }
+        continue;
+      }
+
+      node = scene.CreateBone(boneName);
+    }
+
+    uni::RTSValue boneTM;
+    b->GetTM(boneTM);
+
+    BoneTransform tm;
+    tm.rotation = boneTM.rotation.QConjugate();
+    tm.translation = boneTM.translation * settings.scale;
+    tm.translation.W = 0.f;
+
+    auto parentBone = b->Parent();
+
+    if (settings.additive) {
+      tm = scene.LocalTransform(node, -1);
+    } else if (parentBone) {
+      auto parent = nodes.find(parentBone->Index());
+
+      if (parent != nodes.end()) {
+        scene.SetParent(node, parent->second);
+      }
+    } else {
+      CorrectRootPositions(&tm.translation, 1);
+      CorrectRootRotations(&tm.rotation, 1);
+    }
+
+    scene.PrepareBone(node);
+    scene.SetLocalTransform(node, startTime, tm);
+    scene.SetLocalTransform(node, -1, tm);
+    scene.SetUserProp(node, settings.boneIndexProp,
+                      std::to_string(b->Index()));
+    nodes[b->Index()] = node;
+  }
+}
+
+CommitStats CommitSamples(SceneBackend &scene, const MotionSamples &samples,
+                          const FrameGrid &grid, const BoneNodes &nodes,
+                          ScenePose *pose) {
+  CommitStats stats;
+  std::vector<int32> times;
+  std::vector<Vector4A16> values;
+
+  for (auto &v : samples) {
+    auto found = nodes.find(v.boneIndex);
+
+    if (found == nodes.end()) {
+      stats.numSkippedTracks++;
+      continue;
+    }
+
+    const SceneBackend::Node node = found->second;
+    const bool isRoot = scene.Parent(node) == SceneBackend::NO_NODE;
+    const bool everyFrame =
+        !v.keyFrames.empty() && !scene.HasLinearKeys(node, v.trackType);
+    const size_t numKeys = everyFrame ? v.values.size() : v.NumKeys();
+
+    if (!numKeys) {
+      continue;
+    }
+
+    if (everyFrame) {
+      stats.numUnreducedTracks++;
+    }
+
+    times.resize(numKeys);
+    values.resize(numKeys);
+
+    for (size_t k = 0; k < numKeys; k++) {
+      const size_t frame = everyFrame ? k : v.KeyFrame(k);
+      times[k] = grid.ticks[frame];
+      values[k] = v.values[frame];
+    }
+
+    switch (v.trackType) {
+    case uni::MotionTrack::Position:
+    case uni::MotionTrack::Scale:
+      if (isRoot) {
+        CorrectRootPositions(values.data(), numKeys);
+      }
+      break;
+    case uni::MotionTrack::Rotation:
+      if (isRoot) {
+        CorrectRootRotations(values.data(), numKeys);
+      }
+
+      stats.numRotationKeys += numKeys;
+      break;
+    default:
+      continue;
+    }
+
+    scene.CommitKeys(node, v.trackType, times.data(), values.data(), numKeys);
+    stats.numKeys += numKeys;
+
+    if (!pose) {
+      continue;
+    }
+
+    switch (v.trackType) {
+    case uni::MotionTrack::Position:
+      pose->SetEndTranslation(node, values.back());
+      break;
+    case uni::MotionTrack::Rotation:
+      pose->SetEndRotation(node, values.back());
+      break;
+    default:
+      pose->SetEndScale(node, values.back());
+      break;
+    }
+  }
+
+  return stats;
+}
+} // namespace revilmax
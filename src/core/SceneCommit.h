@@ -0,0 +1,63 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "MotionSampler.h"
+#include "ScenePose.h"
+#include "uni/skeleton.hpp"
+#include <unordered_map>
+
+// RE Engine scene import on top of SceneBackend
+namespace revilmax {
+struct SkeletonImportSettings {
+  float scale = 1.f;
+  // Bones are neither created nor parented, rest pose is kept from scene
+  bool additive = false;
+  bool logMissingBones = true;
+  // User property holding bone index
+  std::string boneIndexProp = "BoneHash";
+};
+
+// Bone index -> scene node
+using BoneNodes = std::unordered_map<uint32, SceneBackend::Node>;
+
+// Finds bone nodes by name or creates them, then keys bone transforms at
+// startTime and at rest pose time -1.
+void ImportSkeleton(SceneBackend &scene, const uni::Skeleton &skel,
+                    int32 startTime, const SkeletonImportSettings &settings,
+                    BoneNodes &nodes);
+
+struct CommitStats {
+  size_t numKeys = 0;
+  size_t numRotationKeys = 0;
+  size_t numSkippedTracks = 0;
+  // Reduced tracks of nodes, that don't interpolate keys linearly
+  size_t numUnreducedTracks = 0;
+};
+
+// Writes prepared samples as keys at grid ticks.
+// Keys of bones parented to scene root are corrected into Z up space.
+// Tracks of bones missing in nodes are skipped.
+// Reduced tracks are keyed at every frame, unless node interpolates them
+// linearly.
+// Last key of every track is recorded into pose, if provided.
+CommitStats CommitSamples(SceneBackend &scene, const MotionSamples &samples,
+                          const FrameGrid &grid, const BoneNodes &nodes,
+                          ScenePose *pose = nullptr);
+} // namespace revilmax
@@ -0,0 +1,85 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "ScenePose.h"
+
+namespace revilmax {
+void ScenePose::Build(SceneBackend &scene_, const std::vector<Node> &nodes_,
+                      const std::vector<BoneTransform> &restPose_) {
+  scene = &scene_;
+  nodes = nodes_;
+  restPose = restPose_;
+  boneIndices.clear();
+
+  for (size_t n = 0; n < nodes.size(); n++) {
+    boneIndices.emplace(nodes[n], n);
+  }
+
+  ResetEndPose();
+}
+
+void ScenePose::Build(SceneBackend &scene_, const std::vector<Node> &nodes_) {
+  std::vector<BoneTransform> rest;
+  rest.reserve(nodes_.size());
+
+  for (auto n : nodes_) {
+    rest.push_back(scene_.LocalTransform(n, -1));
+  }
+
+  Build(scene_, nodes_, rest);
+}
+
+int32 ScenePose::FindBone(Node node) const {
+  auto found = boneIndices.find(node);
+  return found == boneIndices.end() ? -1 : static_cast<int32>(found->second);
+}
+
+void ScenePose::SetEndTranslation(Node node, const Vector4A16 &value) {
+  const int32 bone = FindBone(node);
+
+  if (bone >= 0) {
+    endPose[bone].translation = value;
+    endPose[bone].translation.W = 0.f;
+  }
+}
+
+void ScenePose::SetEndRotation(Node node, const Vector4A16 &value) {
+  const int32 bone = FindBone(node);
+
+  if (bone >= 0) {
+    endPose[bone].rotation = value;
+  }
+}
+
+void ScenePose::SetEndScale(Node node, const Vector4A16 &value) {
+  const int32 bone = FindBone(node);
+
+  if (bone >= 0) {
+    endPose[bone].scale = value;
+    endPose[bone].scale.W = 0.f;
+  }
+}
+
+void ScenePose::KeyPose(const std::vector<BoneTransform> &pose,
+                        int32 atTime) const {
+  for (size_t b = 0; b < nodes.size(); b++) {
+    scene->SetLocalTransform(nodes[b], atTime, pose[b]);
+  }
+}
+} // namespace revilmax
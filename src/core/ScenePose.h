@@ -0,0 +1,61 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include "BoneTransform.h"
+#include "SceneBackend.h"
+#include <unordered_map>
+#include <vector>
+
+namespace revilmax {
+// Rest pose and last committed pose of scene bones, so poses are keyed from
+// buffers instead of evaluating scene nodes.
+class ScenePose {
+public:
+  using Node = SceneBackend::Node;
+
+  // restPose holds local transform of every node
+  void Build(SceneBackend &scene, const std::vector<Node> &nodes,
+             const std::vector<BoneTransform> &restPose);
+  // Rest pose is read from scene at time -1
+  void Build(SceneBackend &scene, const std::vector<Node> &nodes);
+
+  // -1 if node is not a skeleton bone
+  int32 FindBone(Node node) const;
+  const BoneTransform &Rest(size_t bone) const { return restPose[bone]; }
+
+  // Pose held after last committed key, starts as rest pose
+  void ResetEndPose() { endPose = restPose; }
+  void SetEndTranslation(Node node, const Vector4A16 &value);
+  void SetEndRotation(Node node, const Vector4A16 &value);
+  void SetEndScale(Node node, const Vector4A16 &value);
+
+  void KeyEndPose(int32 atTime) const { KeyPose(endPose, atTime); }
+  void KeyRestPose(int32 atTime) const { KeyPose(restPose, atTime); }
+
+private:
+  SceneBackend *scene = nullptr;
+  std::vector<Node> nodes;
+  std::unordered_map<Node, size_t> boneIndices;
+  std::vector<BoneTransform> restPose;
+  std::vector<BoneTransform> endPose;
+
+  void KeyPose(const std::vector<BoneTransform> &pose, int32 atTime) const;
+};
+} // namespace revilmax
@@ -0,0 +1,162 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#include "WorkerPool.h"
+#include <memory>
+
+namespace revilmax {
+static thread_local bool insideJob = false;
+static std::unique_ptr<WorkerPool> sharedPool;
+static std::mutex sharedPoolMutex;
+
+WorkerPool::WorkerPool(size_t numWorkers) {
+  if (!numWorkers) {
+    const size_t numThreads = std::thread::hardware_concurrency();
+    // Calling thread is a worker too
+    numWorkers = numThreads > 1 ? numThreads - 1 : 0;
+  }
+
+  for (size_t i = 0; i < numWorkers; i++) {
+    workers.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    terminate = true;
+  }
+
+  wakeUp.notify_all();
+
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+WorkerPool &WorkerPool::Get() {
+  std::lock_guard<std::mutex> lock(sharedPoolMutex);
+
+  if (!sharedPool) {
+    sharedPool = std::make_unique<WorkerPool>();
+  }
+
+  return *sharedPool;
+}
+
+void WorkerPool::Release() {
+  std::lock_guard<std::mutex> lock(sharedPoolMutex);
+  sharedPool.reset();
+}
+
+void WorkerPool::RunJob(Job &job) {
+  const bool wasInside = insideJob;
+  insideJob = true;
+
+  while (true) {
+    const size_t index = job.next.fetch_add(1);
+
+    if (index >= job.count) {
+      break;
+    }
+
+    try {
+      (*job.func)(index);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.exceptionMutex);
+
+      if (!job.exception) {
+        job.exception = std::current_exception();
+      }
+    }
+
+    job.remaining.fetch_sub(1);
+  }
+
+  insideJob = wasInside;
+}
+
+void WorkerPool::WorkerLoop() {
+  size_t lastGeneration = 0;
+
+  while (true) {
+    Job *job;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wakeUp.wait(lock, [&] {
+        return terminate || (currentJob && generation != lastGeneration);
+      });
+
+      if (terminate) {
+        return;
+      }
+
+      lastGeneration = generation;
+      job = currentJob;
+      activeWorkers++;
+    }
+
+    RunJob(*job);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      activeWorkers--;
+    }
+
+    jobDone.notify_all();
+  }
+}
+
+void WorkerPool::ParallelFor(size_t count, const JobFunc &func) {
+  if (insideJob || workers.empty() || count < 2) {
+    for (size_t i = 0; i < count; i++) {
+      func(i);
+    }
+
+    return;
+  }
+
+  std::lock_guard<std::mutex> submitLock(submitMutex);
+  Job job;
+  job.func = &func;
+  job.count = count;
+  job.remaining = count;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentJob = &job;
+    generation++;
+  }
+
+  wakeUp.notify_all();
+  RunJob(job);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock,
+                 [&] { return !job.remaining.load() && !activeWorkers; });
+    currentJob = nullptr;
+  }
+
+  if (job.exception) {
+    std::rethrow_exception(job.exception);
+  }
+}
+} // namespace revilmax
@@ -0,0 +1,77 @@
+/*  Revil Tool for 3ds Max
+    Copyright(C) 2019-2022 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+
+    Revil Tool uses RevilLib 2017-2020 Lukas Cone
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace revilmax {
+// Persistent worker threads for independent jobs.
+// Idle workers pull the next unclaimed index, so uneven jobs balance out.
+class WorkerPool {
+public:
+  using JobFunc = std::function<void(size_t index)>;
+
+  // numWorkers == 0 will use hardware concurrency
+  explicit WorkerPool(size_t numWorkers = 0);
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  ~WorkerPool();
+
+  // Calls func for every index in [0, count) and blocks until all are done.
+  // Calling thread takes part in the work.
+  // First exception thrown by any job is rethrown here.
+  // Called from within a job, it will run serially.
+  void ParallelFor(size_t count, const JobFunc &func);
+  size_t NumWorkers() const { return workers.size(); }
+
+  // Shared pool, created on first use
+  static WorkerPool &Get();
+  // Joins shared pool workers, must be called before module unload
+  static void Release();
+
+private:
+  struct Job {
+    const JobFunc *func = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> remaining{0};
+    std::exception_ptr exception;
+    std::mutex exceptionMutex;
+  };
+
+  std::vector<std::thread> workers;
+  std::mutex submitMutex;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::condition_variable jobDone;
+  Job *currentJob = nullptr;
+  size_t generation = 0;
+  size_t activeWorkers = 0;
+  bool terminate = false;
+
+  void WorkerLoop();
+  void RunJob(Job &job);
+};
+} // namespace revilmax
@@ -18,6 +18,15 @@
 #define IDC_CH_ADDITIVE                 1007
 #define IDC_CH_NO_CACHE                 1008
 #define IDC_CH_NOLOGBONES                  1009
+#define IDC_CH_MULTITHREAD              1010
+#define IDC_CH_REDUCEKEYS               1011
+#define IDC_EDIT_POSTOL                 1012
+#define IDC_SPIN_POSTOL                 1013
+#define IDC_EDIT_ROTTOL                 1014
+#define IDC_SPIN_ROTTOL                 1015
+#define IDC_EDIT_SCLTOL                 1016
+#define IDC_SPIN_SCLTOL                 1017
+#define IDC_CH_NATIVEKEYS               1018
 
 // Next default values for new objects
 // 
@@ -25,7 +34,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        105
 #define _APS_NEXT_COMMAND_VALUE         40001
-#define _APS_NEXT_CONTROL_VALUE         1010
+#define _APS_NEXT_CONTROL_VALUE         1019
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif